@@ -0,0 +1,86 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../history.h"
+
+/* Reverse search benchmark - writes a history file of one million command lines, then times loading
+ * it, the background trigram index build and the searches once it is ready */
+
+using namespace std;
+
+#define BENCH_ENTRIES (1000000)
+#define BENCH_QUERIES (2000)
+
+const char *COMMANDS[] = {"ls -l", "cd", "git commit -m", "grep -rn", "make -j8", "vim", "cat", "ssh deploy@host", "find . -name"};
+
+string _makeEntry(mt19937 &random)
+{
+    string entry = COMMANDS[random() % (sizeof(COMMANDS) / sizeof(COMMANDS[0]))];
+    entry += " src/module_" + to_string(random() % 5000) + "/file_" + to_string(random() % 100000) + ".cpp";
+    return entry;
+}
+
+double _elapsedMs(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    char path[] = "/tmp/smash_history_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        perror("mkstemp");
+        return 1;
+    }
+    mt19937 random(1);
+    vector<string> samples;
+    string text;
+    for (int i = 0; i < BENCH_ENTRIES; i++)
+    {
+        string entry = _makeEntry(random);
+        if (i % (BENCH_ENTRIES / BENCH_QUERIES) == 0)
+            samples.push_back(entry);
+        text += entry + '\n';
+    }
+    if (write(fd, text.data(), text.size()) != (ssize_t)text.size())
+        perror("write");
+    close(fd);
+
+    History history;
+    auto start = chrono::steady_clock::now();
+    history.open(path);
+    printf("%zu entries, %.1f MiB\n", history.size(), text.size() / 1048576.0);
+    printf("  load          %10.2f ms\n", _elapsedMs(start));
+
+    // The index is built in the background, a search before it is ready scans every entry
+    auto scanStart = chrono::steady_clock::now();
+    history.search("no such command", history.size());
+    printf("  full scan     %10.2f ms\n", _elapsedMs(scanStart));
+    while (!history.isIndexed())
+        usleep(1000);
+    printf("  index build   %10.2f ms\n", _elapsedMs(start));
+
+    // Queries are pieces of real entries, as typed while searching
+    double total = 0, worst = 0;
+    size_t found = 0;
+    for (const string &sample : samples)
+    {
+        string query = sample.substr(sample.find("module_"), 16);
+        start = chrono::steady_clock::now();
+        found += history.search(query, history.size()) >= 0;
+        double elapsed = _elapsedMs(start);
+        total += elapsed;
+        worst = max(worst, elapsed);
+    }
+    printf("  search        %10.4f ms average, %.4f ms worst, %zu/%zu found\n", total / samples.size(), worst, found,
+           samples.size());
+
+    unlink(path);
+    return 0;
+}
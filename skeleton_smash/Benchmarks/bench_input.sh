@@ -0,0 +1,27 @@
+#!/bin/bash
+# Input throughput benchmark - feeds one million trivial builtin lines to smash and reports lines/s.
+# Usage: bench_input.sh [smash binary] [other smash binary to compare against]
+
+LINES=1000000
+SMASH=${1:-./smash}
+INPUT=$(mktemp)
+trap 'rm -f "$INPUT"' EXIT
+
+# 'chprompt' with no arguments resets the prompt and prints nothing, so the run measures the input
+# loop and the command dispatch rather than the terminal
+yes chprompt | head -n $LINES > "$INPUT"
+echo quit >> "$INPUT"
+
+measure() {
+    local start end
+    start=$(date +%s.%N)
+    "$1" < "$INPUT" > /dev/null
+    end=$(date +%s.%N)
+    awk -v binary="$1" -v lines=$LINES -v start="$start" -v end="$end" \
+        'BEGIN { printf "%-40s %8.3f s %12.0f lines/s\n", binary, end - start, lines / (end - start) }'
+}
+
+measure "$SMASH"
+if [ -n "$2" ]; then
+    measure "$2"
+fi
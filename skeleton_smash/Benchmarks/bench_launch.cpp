@@ -0,0 +1,66 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "../Commands.h"
+
+/* External command launch rate - runs /bin/true back to back through each launcher backend while the
+ * shell holds 16 MiB to 512 MiB of touched memory, which fork has to copy the page tables of. A timed
+ * pass then gives the average time from the fork to the exec */
+
+using namespace std;
+
+#define BENCH_LAUNCHES (2000)
+#define BENCH_TIMED_LAUNCHES (200)
+
+const size_t RSS_SIZES_MIB[] = {16, 128, 512};
+
+/* Launches /bin/true 'count' times, waiting for each, and returns the seconds taken. The exec latency
+ * of every launch is added to 'totalLatency' when timing is on */
+double _runLaunches(LaunchBackend backend, int count, double &totalLatency)
+{
+    char program[] = "/bin/true";
+    char *argv[] = {program, nullptr};
+    Launcher::setBackend(backend);
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i++)
+    {
+        pid_t pid = Launcher::launch(LaunchPlan{program, argv, environ, vector<FdAction>()});
+        if (pid < 0)
+            return 0;
+        totalLatency += Launcher::getExecLatency();
+        int status;
+        waitpid(pid, &status, 0);
+    }
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main()
+{
+    const LaunchBackend backends[] = {LAUNCH_SPAWN, LAUNCH_FORK};
+    printf("%10s %12s %12s %16s %16s\n", "rss", "spawn/sec", "fork/sec", "spawn us->exec", "fork us->exec");
+    for (size_t mib : RSS_SIZES_MIB)
+    {
+        // Every page is written so it is resident, as in a long running shell
+        vector<char> memory(mib << 20);
+        memset(memory.data(), 1, memory.size());
+
+        double rates[2], latencies[2];
+        for (int i = 0; i < 2; i++)
+        {
+            double unused = 0;
+            Launcher::setTiming(false);
+            rates[i] = BENCH_LAUNCHES / _runLaunches(backends[i], BENCH_LAUNCHES, unused);
+
+            double totalLatency = 0;
+            Launcher::setTiming(true);
+            _runLaunches(backends[i], BENCH_TIMED_LAUNCHES, totalLatency);
+            latencies[i] = totalLatency / BENCH_TIMED_LAUNCHES;
+        }
+        printf("%6zu MiB %12.0f %12.0f %16.0f %16.0f\n", mib, rates[0], rates[1], latencies[0], latencies[1]);
+    }
+    return 0;
+}
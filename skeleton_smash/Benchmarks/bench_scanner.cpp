@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include "../scanner.h"
+
+/* Microbenchmark of the command line scanner - tokenizes 64 KiB and 1 MiB lines with the old byte by
+ * byte loop and with every scanner level the CPU supports */
+
+using namespace std;
+
+#define BENCH_MIN_BYTES (256u << 20)   // bytes scanned per measurement
+
+constexpr string_view WHITESPACE = " \n\r\t\f\v";
+
+/* Builds a line of file arguments with a pipe or redirection every few hundred words */
+string _makeLine(size_t size, unsigned int seed)
+{
+    mt19937 random(seed);
+    string line = "ls";
+    while (line.size() < size)
+    {
+        unsigned int kind = random() % 256;
+        if (kind == 0)
+            line += " | ";
+        else if (kind == 1)
+            line += " >> ";
+        else if (kind == 2)
+            line += " < ";
+        else if (kind == 3)
+            line += " in<";     // a '<' inside a word is part of it
+        else
+            line += " ";
+
+        // Paths like the ones a glob expands to
+        line += "src/module_" + to_string(random() % 1000) + "/file";
+        line += string(random() % 24, 'a' + random() % 26) + ".cpp";
+    }
+    line.resize(size);
+    return line;
+}
+
+/* The tokenizer loop before the scanner, testing every byte against the whitespace and operators */
+size_t _countTokensBytewise(const string &line)
+{
+    size_t tokens = 0, length = line.size(), i = 0;
+    while (i < length)
+    {
+        if (WHITESPACE.find(line[i]) != string::npos)
+        {
+            i++;
+            continue;
+        }
+        tokens++;
+        if (line[i] == '>' || line[i] == '|' || line[i] == '&')
+        {
+            i++;
+            continue;
+        }
+        while (i < length && WHITESPACE.find(line[i]) == string::npos && line[i] != '>' && line[i] != '|' && line[i] != '&')
+            i++;
+    }
+    return tokens;
+}
+
+size_t _countTokensScanner(const string &line)
+{
+    const char *data = line.data();
+    size_t tokens = 0, length = line.size(), i = 0;
+    while ((i = skipWhitespace(data, i, length)) < length)
+    {
+        tokens++;
+        if (data[i] == '>' || data[i] == '|' || data[i] == '&')
+            i++;
+        else
+            i = scanBoundary(data, i + 1, length);
+    }
+    return tokens;
+}
+
+/* Returns the throughput in MiB/s, the token count guards against the loop being optimized away */
+double _measure(const string &line, size_t (*countTokens)(const string &), size_t &tokens)
+{
+    size_t rounds = BENCH_MIN_BYTES / line.size() + 1;
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; i++)
+    {
+        // Keep the compiler from hoisting the scan out of the loop
+        asm volatile("" : : "g"(line.data()) : "memory");
+        tokens = countTokens(line);
+    }
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    return (double)rounds * line.size() / elapsed.count() / (1 << 20);
+}
+
+int main()
+{
+    const size_t sizes[] = {64u << 10, 1u << 20};
+    for (size_t size : sizes)
+    {
+        string line = _makeLine(size, 1);
+        size_t expected;
+        double baseline = _measure(line, _countTokensBytewise, expected);
+        printf("%5zu KiB line, %zu tokens\n", size >> 10, expected);
+        printf("  %-8s %10.1f MiB/s\n", "bytewise", baseline);
+
+        for (ScannerLevel level : {SCANNER_SCALAR, SCANNER_SSE2, SCANNER_AVX2})
+        {
+            if (!setScannerLevel(level))
+                continue;
+            size_t tokens;
+            double throughput = _measure(line, _countTokensScanner, tokens);
+            printf("  %-8s %10.1f MiB/s  x%.2f%s\n", getScannerName(level), throughput, throughput / baseline,
+                   (tokens == expected) ? "" : "  (token count mismatch)");
+        }
+    }
+    return 0;
+}
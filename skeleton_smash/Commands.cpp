@@ -4,11 +4,12 @@
 #include <iostream>
 #include <algorithm>
 #include <vector>
+#include <string_view>
 #include <sstream>
 #include <sys/wait.h>
 #include <iomanip>
 #include "Commands.h"
-#include <regex>
+#include "scanner.h"
 #include <dirent.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -17,8 +18,16 @@
 #include <fcntl.h>
 #include <pwd.h>
 #include <grp.h>
+#include <cstdint>
+#include <thread>
+#include <cerrno>
+#include <sys/mman.h>
+#include <spawn.h>
+#include <chrono>
+#include <atomic>
+#include <new>
 
-const string WHITESPACE = " \n\r\t\f\v";
+constexpr string_view WHITESPACE = " \n\r\t\f\v";
 
 #if 0
 #define FUNC_ENTRY() \
@@ -31,93 +40,1788 @@ const string WHITESPACE = " \n\r\t\f\v";
 #define FUNC_EXIT()
 #endif
 
+// Set to 1 to print the command arena usage and the heap allocations after every command line
+#define ARENA_STATS 0
+
+#if ARENA_STATS
+/* Every malloc of the process, operator new included, is counted on its way to the glibc allocator */
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+
+static atomic<size_t> _heapAllocations(0);
+
+extern "C" void *malloc(size_t size) noexcept
+{
+    _heapAllocations++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size) noexcept
+{
+    _heapAllocations++;
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size) noexcept
+{
+    _heapAllocations++;
+    return __libc_realloc(ptr, size);
+}
+#endif
+
 /*---------------------------------------------------------------------------------------------------*/
 /*---------------------------------------------- Utils ----------------------------------------------*/
 /*---------------------------------------------------------------------------------------------------*/
 
-string _ltrim(const string &s)
+string_view _ltrim(string_view s)
 {
-    size_t start = s.find_first_not_of(WHITESPACE);
-    return (start == string::npos) ? "" : s.substr(start);
+    return s.substr(skipWhitespace(s.data(), 0, s.size()));
 }
 
-string _rtrim(const string &s)
+string_view _rtrim(string_view s)
 {
     size_t end = s.find_last_not_of(WHITESPACE);
-    return (end == string::npos) ? "" : s.substr(0, end + 1);
+    return (end == string_view::npos) ? string_view() : s.substr(0, end + 1);
 }
 
-string _trim(const string &s)
+string_view _trim(string_view s)
 {
     return _rtrim(_ltrim(s));
 }
 
-int _parseCommandLine(const char *cmd_line, char **args)
+/* Returns the first word of the command line (the command) */
+string_view _firstWord(string_view cmd_line)
+{
+    cmd_line = _ltrim(cmd_line);
+    return cmd_line.substr(0, scanWhitespace(cmd_line.data(), 0, cmd_line.size()));
+}
+
+bool _isBackgroundCommand(string_view cmd_line)
+{
+    cmd_line = _rtrim(cmd_line);
+    return !cmd_line.empty() && cmd_line.back() == '&';
+}
+
+bool _isAliasNameChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+/* Validates "alias <name>='<body>'" in a single pass - the name is [a-zA-Z0-9_]+, the body has no
+ * quote, and the closing quote ends the line. Returns views of the name and the body */
+bool _parseAliasDefinition(string_view line, string_view &name, string_view &body)
+{
+    constexpr string_view PREFIX = "alias ";
+    if (line.substr(0, PREFIX.size()) != PREFIX)
+        return false;
+
+    size_t i = PREFIX.size(), start = i;
+    while (i < line.size() && _isAliasNameChar(line[i]))
+        i++;
+    if (i == start || line.substr(i, 2) != "='")
+        return false;
+    name = line.substr(start, i - start);
+
+    start = i + 2;
+    size_t quote = line.find('\'', start);
+    if (quote != line.size() - 1)
+        return false;
+    body = line.substr(start, quote - start);
+    return true;
+}
+
+/* Converts a status from waitpid to a shell exit status - 128 plus the signal for a killed process */
+int _exitStatus(int status)
+{
+    if (WIFSIGNALED(status))
+        return 128 + WTERMSIG(status);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 0;
+}
+
+/* Returns the command line without the background sign and everything after it */
+string_view _removeBackgroundSign(string_view cmd_line)
+{
+    string_view trimmed = _rtrim(cmd_line);
+    return _isBackgroundCommand(trimmed) ? trimmed.substr(0, trimmed.size() - 1) : cmd_line;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Arena Allocator -----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+Arena::Arena(size_t blockSize) : m_blocks(), m_blockSize(blockSize), m_current(0), m_offset(0), m_allocationCount(0) {}
+
+Arena::~Arena()
+{
+    for (Block &block : m_blocks)
+        free(block.data);
+}
+
+void *Arena::allocate(size_t size, size_t alignment)
+{
+    m_allocationCount++;
+
+    // Use the current block, moving on to blocks kept from previous lines when it is full
+    while (m_current < m_blocks.size())
+    {
+        size_t start = (m_offset + alignment - 1) & ~(alignment - 1);
+        if (start + size <= m_blocks[m_current].size)
+        {
+            m_offset = start + size;
+            return m_blocks[m_current].data + start;
+        }
+        if (m_current + 1 == m_blocks.size() || m_blocks[m_current + 1].size < size)
+            break;
+        m_current++;
+        m_offset = 0;
+    }
+
+    // Out of space - get a new block after the current one, big enough for oversized requests
+    Block block;
+    block.size = max(size, m_blockSize);
+    block.data = (char *)malloc(block.size);
+    if (block.data == nullptr)
+        throw bad_alloc();
+
+    size_t position = m_blocks.empty() ? 0 : m_current + 1;
+    m_blocks.insert(m_blocks.begin() + position, block);
+    m_current = position;
+    m_offset = size;
+    return block.data;
+}
+
+/* Copies the string into the arena and terminates it with '\0' */
+char *Arena::copyString(const char *str, size_t length)
+{
+    char *copy = (char *)allocate(length + 1, 1);
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+Arena::Mark Arena::getMark() const
+{
+    Mark mark;
+    mark.block = m_current;
+    mark.offset = m_offset;
+    return mark;
+}
+
+/* Releases everything allocated after the mark was taken, the blocks are kept for reuse */
+void Arena::rewind(Mark mark)
+{
+    m_current = mark.block;
+    m_offset = mark.offset;
+}
+
+void Arena::reset()
+{
+    m_current = 0;
+    m_offset = 0;
+}
+
+size_t Arena::getAllocationCount() const
+{
+    return m_allocationCount;
+}
+
+size_t Arena::getBlockCount() const
+{
+    return m_blocks.size();
+}
+
+ArenaScope::ArenaScope(Arena &arena) : m_arena(arena), m_mark(arena.getMark()) {}
+
+ArenaScope::~ArenaScope()
+{
+    m_arena.rewind(m_mark);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Argument Vector -----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+ArgVector::ArgVector() : m_data(m_inline), m_size(0), m_capacity(ARGV_INLINE_SIZE), m_bytes(0), m_overflowed(false)
+{
+    m_inline[0] = nullptr;
+}
+
+ArgVector::~ArgVector()
+{
+    if (m_data != m_inline)
+        free(m_data);
+}
+
+/* Appends an argument (the string is not copied), false if exec could not take it anymore */
+bool ArgVector::push(char *arg)
+{
+    static const size_t argMax = sysconf(_SC_ARG_MAX);
+    size_t bytes = strlen(arg) + 1 + sizeof(char *);
+    if (m_bytes + bytes > argMax)
+    {
+        m_overflowed = true;
+        return false;
+    }
+
+    // Keep room for the NULL terminator, doubling the storage when it runs out
+    if (m_size + 1 == m_capacity)
+    {
+        char **data = (char **)malloc(2 * m_capacity * sizeof(char *));
+        if (data == nullptr)
+            throw bad_alloc();
+        memcpy(data, m_data, m_size * sizeof(char *));
+        if (m_data != m_inline)
+            free(m_data);
+        m_data = data;
+        m_capacity *= 2;
+    }
+
+    m_data[m_size++] = arg;
+    m_data[m_size] = nullptr;
+    m_bytes += bytes;
+    return true;
+}
+
+size_t ArgVector::size() const
+{
+    return m_size;
+}
+
+bool ArgVector::isOverflowed() const
+{
+    return m_overflowed;
+}
+
+char *const *ArgVector::data() const
+{
+    return m_data;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*--------------------------------------- Command Line Parser ---------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+
+/* Splits a command line into words and operators ('>', '>>', '|', '|&' and a trailing '&'),
+ * the words are copied into the arena. Token boundaries are found by the vectorized scanner */
+ArenaVector<Token> _lexCommandLine(string_view line, Arena &arena)
+{
+    ArenaVector<Token> tokens((ArenaAllocator<Token>(arena)));
+    const char *data = line.data();
+    size_t length = line.size();
+    size_t last = line.find_last_not_of(WHITESPACE); // position of a trailing background sign
+    size_t i = 0;
+
+    // Skip whitespace between tokens
+    while ((i = skipWhitespace(data, i, length)) < length)
+    {
+        char c = line[i];
+        Token token;
+
+        // Operators
+        if (c == '>')
+        {
+            bool isAppend = (i + 1 < length && line[i + 1] == '>');
+            token.type = isAppend ? TOKEN_REDIRECT_APPEND : TOKEN_REDIRECT;
+            token.text = nullptr;
+            i += isAppend ? 2 : 1;
+        }
+        else if (c == '|')
+        {
+            bool isErr = (i + 1 < length && line[i + 1] == '&');
+            token.type = isErr ? TOKEN_PIPE_ERR : TOKEN_PIPE;
+            token.text = nullptr;
+            i += isErr ? 2 : 1;
+        }
+        else if (c == '&' && i == last)
+        {
+            token.type = TOKEN_BACKGROUND;
+            token.text = nullptr;
+            i++;
+        }
+
+        // A word runs until whitespace or the next operator, an '&' inside a word is part of it. Its
+        // first byte is always taken, so the scan moves on whatever the byte is
+        else
+        {
+            size_t start = i;
+            i = scanBoundary(data, i + 1, length);
+            while (i < length && line[i] == '&' && i != last)
+                i = scanBoundary(data, i + 1, length);
+            token.type = TOKEN_WORD;
+            token.text = arena.copyString(line.data() + start, i - start);
+        }
+
+        tokens.push_back(token);
+    }
+    return tokens;
+}
+
+/* Inserts copies of the tokens of an alias at the position, a background sign of the body is left out.
+ * Returns the number of tokens inserted */
+size_t _spliceAliasTokens(const vector<AliasTable::BodyToken> &body, ArenaVector<Token> &tokens, size_t position, Arena &arena)
+{
+    size_t count = body.size();
+    if (count > 0 && body.back().type == TOKEN_BACKGROUND)
+        count--;
+
+    tokens.insert(tokens.begin() + position, count, Token());
+    for (size_t i = 0; i < count; i++)
+    {
+        tokens[position + i].type = body[i].type;
+        tokens[position + i].text = (body[i].type == TOKEN_WORD) ? arena.copyString(body[i].text.c_str(), body[i].text.size()) : nullptr;
+    }
+    return count;
+}
+
+/* Joins the stages back into a single command line in the arena, used as the text of a sub command */
+const char *_joinStages(const ArenaVector<CommandStage> &stages, Arena &arena)
+{
+    string text;
+    for (size_t i = 0; i < stages.size(); i++)
+    {
+        for (size_t w = 0; w < stages[i].words.size(); w++)
+            text += string(w == 0 ? "" : " ") + stages[i].words[w];
+        if (stages[i].hasRedirection)
+            text += string(stages[i].isAppend ? " >> " : " > ") + stages[i].redirectTarget;
+        if (i + 1 < stages.size())
+            text += stages[i].isPipeErr ? " |& " : " | ";
+    }
+    return arena.copyString(text.c_str(), text.size());
+}
+
+CommandStage::CommandStage(Arena &arena) : words(ArenaAllocator<char *>(arena)), hasRedirection(false), isAppend(false),
+                                           isPipeErr(false), redirectTarget("") {}
+
+CommandAST::CommandAST(Arena &arena) : stages(ArenaAllocator<CommandStage>(arena)), isBackground(false), text("") {}
+
+Arena &CommandAST::getArena() const
+{
+    return *stages.get_allocator().getArena();
+}
+
+bool CommandAST::isEmpty() const
+{
+    for (const CommandStage &stage : stages)
+    {
+        if (!stage.words.empty() || stage.hasRedirection)
+            return false;
+    }
+    return true;
+}
+
+/* Returns the command name - the first word of the first stage */
+const char *CommandAST::firstWord() const
+{
+    return (stages.empty() || stages[0].words.empty()) ? "" : stages[0].words[0];
+}
+
+/* Returns a new AST in the given arena holding the stages [first, last) - the text is rebuilt from the stages */
+CommandAST CommandAST::slice(size_t first, size_t last, Arena &arena) const
+{
+    CommandAST ast(arena);
+    ast.stages.reserve(last - first);
+    for (size_t i = first; i < last; i++)
+    {
+        ast.stages.push_back(CommandStage(arena));
+        CommandStage &stage = ast.stages.back();
+        stage.words.assign(stages[i].words.begin(), stages[i].words.end());
+        stage.hasRedirection = stages[i].hasRedirection;
+        stage.isAppend = stages[i].isAppend;
+        stage.isPipeErr = stages[i].isPipeErr;
+        stage.redirectTarget = stages[i].redirectTarget;
+    }
+    ast.stages.back().isPipeErr = false;
+    ast.text = _joinStages(ast.stages, arena);
+    return ast;
+}
+
+/* Returns a copy of a single stage AST without its output redirection */
+CommandAST CommandAST::withoutRedirection(Arena &arena) const
+{
+    CommandAST ast = slice(0, stages.size(), arena);
+    ast.stages.back().hasRedirection = false;
+    ast.stages.back().redirectTarget = "";
+    ast.text = _joinStages(ast.stages, arena);
+    return ast;
+}
+
+/* Returns a deep copy of the AST - its words and text are copied into the given arena as well, so it
+ * outlives the arena the line was parsed into */
+CommandAST CommandAST::copy(Arena &arena) const
+{
+    CommandAST ast(arena);
+    ast.stages.reserve(stages.size());
+    for (const CommandStage &source : stages)
+    {
+        ast.stages.push_back(CommandStage(arena));
+        CommandStage &stage = ast.stages.back();
+        stage.words.reserve(source.words.size());
+        for (char *word : source.words)
+            stage.words.push_back(arena.copyString(word, strlen(word)));
+        stage.hasRedirection = source.hasRedirection;
+        stage.isAppend = source.isAppend;
+        stage.isPipeErr = source.isPipeErr;
+        stage.redirectTarget = arena.copyString(source.redirectTarget, strlen(source.redirectTarget));
+    }
+    ast.isBackground = isBackground;
+    ast.text = arena.copyString(text, strlen(text));
+    return ast;
+}
+
+CommandPlan::CommandPlan() : arena(PLAN_ARENA_BLOCK_SIZE), ast(arena), factory(nullptr) {}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------ Command Cache ------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+CommandCache::CommandCache(size_t capacity) : m_entries(), m_index(), m_capacity(capacity), m_hits(0), m_misses(0) {}
+
+/* Returns the plan cached for the line and marks it as most recently used, nullptr on a miss */
+shared_ptr<CommandPlan> CommandCache::find(string_view line, unsigned long generation)
+{
+    auto it = m_index.find(line);
+    if (it == m_index.end() || it->second->generation != generation)
+    {
+        m_misses++;
+        return nullptr;
+    }
+
+    m_hits++;
+    it->second->hits++;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->plan;
+}
+
+/* Caches a copy of the line's AST, replacing a stale plan of the same line. A full cache recycles its
+ * least recently used entry - the list and index nodes, the line's storage and, unless a running
+ * command still holds it, the plan with its arena blocks */
+void CommandCache::insert(string_view line, unsigned long generation, const CommandAST &ast, CommandFactory factory)
+{
+    auto it = m_index.find(line);
+    if (it != m_index.end())
+    {
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    if (m_entries.size() >= m_capacity)
+    {
+        // The index node is taken out while its key still views the evicted line
+        auto node = m_index.extract(m_entries.back().line);
+        m_entries.splice(m_entries.begin(), m_entries, prev(m_entries.end()));
+        Entry &entry = m_entries.front();
+        entry.line.assign(line.data(), line.size());
+        entry.generation = generation;
+        entry.hits = 0;
+        if (entry.plan.use_count() == 1)
+            entry.plan->arena.reset();
+        else
+            entry.plan = make_shared<CommandPlan>();
+
+        node.key() = entry.line;
+        node.mapped() = m_entries.begin();
+        m_index.insert(move(node));
+    }
+    else
+    {
+        // The index keys view the line stored in the entry itself
+        m_entries.push_front(Entry{string(line), generation, make_shared<CommandPlan>(), 0});
+        m_index[m_entries.front().line] = m_entries.begin();
+    }
+
+    CommandPlan &plan = *m_entries.front().plan;
+    plan.ast = ast.copy(plan.arena);
+    plan.factory = factory;
+}
+
+void CommandCache::clear()
+{
+    m_index.clear();
+    m_entries.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+/* Prints the cache statistics followed by the cached lines, most recently used first */
+void CommandCache::print() const
+{
+    cout << "smash cache: " << m_entries.size() << "/" << m_capacity << " entries, " << m_hits << " hits, "
+         << m_misses << " misses" << endl;
+    for (const Entry &entry : m_entries)
+        cout << "[" << entry.hits << "] " << entry.line << endl;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------- Alias Table -------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+AliasTable::AliasTable() : m_aliases(), m_index(), m_generation(0) {}
+
+const AliasTable::Alias *AliasTable::find(string_view name) const
+{
+    auto it = m_index.find(name);
+    return (it == m_index.end()) ? nullptr : &*it->second;
+}
+
+/* Adds the alias at the end of the listing order, false if the name is already taken */
+bool AliasTable::insert(const string &name, const string &command, const string &display)
+{
+    if (m_index.find(name) != m_index.end())
+        return false;
+
+    // The body is lexed here once, expansions splice copies of its tokens
+    Arena scratch(PLAN_ARENA_BLOCK_SIZE);
+    vector<BodyToken> tokens;
+    for (const Token &token : _lexCommandLine(command, scratch))
+        tokens.push_back(BodyToken{token.type, (token.text != nullptr) ? token.text : ""});
+
+    // The index keys view the name stored in the alias itself
+    m_aliases.push_back(Alias{name, command, display, move(tokens), "", vector<BodyToken>(), 0, NOT_RESOLVING});
+    m_index[m_aliases.back().name] = prev(m_aliases.end());
+    m_generation++; // every memoized expansion may depend on the new name
+    return true;
+}
+
+bool AliasTable::remove(string_view name)
+{
+    auto it = m_index.find(name);
+    if (it == m_index.end())
+        return false;
+
+    auto alias = it->second;
+    m_index.erase(it);
+    m_aliases.erase(alias);
+    m_generation++;
+    return true;
+}
+
+/* Returns the alias with its resolved body and tokens - every alias the body starts with expanded -
+ * or nullptr if the name is not an alias. Chains are resolved once and then answered from the memo
+ * until the aliases change */
+const AliasTable::Alias *AliasTable::resolve(string_view name)
+{
+    auto it = m_index.find(name);
+    if (it == m_index.end())
+        return nullptr;
+    int cutDepth = 0;
+    resolve(*it->second, 0, cutDepth);
+    return &*it->second;
+}
+
+/* Expands the first word of the body while it is an alias. An alias met again within its own chain
+ * stays a plain word (as in bash), which breaks cycles. 'cutDepth' reports the outermost alias that
+ * stopped the expansion - a result cut by an outer alias depends on the chain and is not memoized */
+void AliasTable::resolve(Alias &alias, int depth, int &cutDepth)
+{
+    if (alias.resolvedGeneration == m_generation)
+        return;
+
+    // An alias name has no operator characters, so it is also the first token of the body
+    alias.resolvingDepth = depth;
+    string_view firstWord = _firstWord(alias.command);
+    auto next = m_index.find(firstWord);
+    bool isCut = (next != m_index.end() && next->second->resolvingDepth != NOT_RESOLVING);
+    int innerCut = isCut ? next->second->resolvingDepth : depth;
+
+    if (next == m_index.end() || isCut)
+    {
+        alias.resolved = alias.command;
+        alias.resolvedTokens = alias.tokens;
+    }
+    else
+    {
+        resolve(*next->second, depth + 1, innerCut);
+        alias.resolved = next->second->resolved;
+        alias.resolved += _ltrim(alias.command).substr(firstWord.size());
+        alias.resolvedTokens = next->second->resolvedTokens;
+        alias.resolvedTokens.insert(alias.resolvedTokens.end(), alias.tokens.begin() + 1, alias.tokens.end());
+    }
+    alias.resolvingDepth = NOT_RESOLVING;
+
+    if (innerCut >= depth)
+        alias.resolvedGeneration = m_generation;
+    cutDepth = min(cutDepth, innerCut);
+}
+
+unsigned long AliasTable::getGeneration() const
+{
+    return m_generation;
+}
+
+const list<AliasTable::Alias> &AliasTable::getAliases() const
+{
+    return m_aliases;
+}
+
+/* Prints the aliases in the order they were defined */
+void AliasTable::print() const
+{
+    for (const Alias &alias : m_aliases)
+        cout << alias.name << alias.display << endl;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Glob Expansion ------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+string _joinPath(const string &base, string_view name)
+{
+    if (base.empty())
+        return string(name);
+    return (base.back() == '/') ? base + string(name) : base + "/" + string(name);
+}
+
+GlobPattern::GlobPattern(string_view pattern) : m_steps(), m_classes(), m_isLiteral(true)
+{
+    for (size_t i = 0; i < pattern.size(); i++)
+    {
+        Step step = {GLOB_CHAR, pattern[i], 0};
+        if (pattern[i] == '?')
+            step.type = GLOB_ANY_CHAR;
+        else if (pattern[i] == '*')
+        {
+            // Consecutive stars match the same as a single one
+            if (!m_steps.empty() && m_steps.back().type == GLOB_ANY_STRING)
+                continue;
+            step.type = GLOB_ANY_STRING;
+        }
+        else if (pattern[i] == '[')
+        {
+            // A ']' right after the opening (or its negation) is part of the class
+            size_t j = i + 1;
+            bool negate = (j < pattern.size() && (pattern[j] == '!' || pattern[j] == '^'));
+            if (negate)
+                j++;
+            size_t end = pattern.find(']', j + 1);
+            if (j >= pattern.size() || end == string_view::npos)
+            {
+                m_steps.push_back(step); // unterminated - a literal '['
+                continue;
+            }
+
+            bitset<256> chars;
+            for (; j < end; j++)
+            {
+                unsigned char first = pattern[j];
+                if (j + 2 < end && pattern[j + 1] == '-')
+                {
+                    for (unsigned int c = first; c <= (unsigned char)pattern[j + 2]; c++)
+                        chars.set(c);
+                    j += 2;
+                }
+                else
+                    chars.set(first);
+            }
+            m_classes.push_back(negate ? ~chars : chars);
+            step.type = GLOB_CLASS;
+            step.classIndex = m_classes.size() - 1;
+            i = end;
+        }
+
+        if (step.type != GLOB_CHAR)
+            m_isLiteral = false;
+        m_steps.push_back(step);
+    }
+}
+
+bool GlobPattern::isLiteral() const
+{
+    return m_isLiteral;
+}
+
+bool GlobPattern::matchesStep(const Step &step, char c) const
 {
-    FUNC_ENTRY()
-    int i = 0;
-    istringstream iss(_trim(string(cmd_line)).c_str());
-    for (string s; iss >> s;)
+    switch (step.type)
+    {
+    case GLOB_CHAR:
+        return step.c == c;
+    case GLOB_CLASS:
+        return m_classes[step.classIndex].test((unsigned char)c);
+    default:
+        return true;
+    }
+}
+
+/* Matches a whole name, backtracking only to the last '*' - hidden names need a literal leading '.' */
+bool GlobPattern::matches(string_view name) const
+{
+    if (name == "." || name == "..")
+        return false;
+    if (!name.empty() && name[0] == '.' && (m_steps.empty() || m_steps[0].type != GLOB_CHAR || m_steps[0].c != '.'))
+        return false;
+
+    size_t step = 0, pos = 0;
+    size_t star = string_view::npos, starPos = 0;
+    while (pos < name.size())
+    {
+        if (step < m_steps.size() && m_steps[step].type == GLOB_ANY_STRING)
+        {
+            star = step++;
+            starPos = pos;
+        }
+        else if (step < m_steps.size() && matchesStep(m_steps[step], name[pos]))
+        {
+            step++;
+            pos++;
+        }
+        else if (star != string_view::npos)
+        {
+            // Let the last star swallow one more character and retry
+            step = star + 1;
+            pos = ++starPos;
+        }
+        else
+            return false;
+    }
+
+    while (step < m_steps.size() && m_steps[step].type == GLOB_ANY_STRING)
+        step++;
+    return step == m_steps.size();
+}
+
+bool GlobExpander::hasWildcards(const char *word)
+{
+    return strpbrk(word, "*?[") != nullptr;
+}
+
+/* Returns the paths matching the word in sorted order, or the word itself when nothing matches */
+vector<string> GlobExpander::expand(const char *word)
+{
+    string_view pattern = word;
+    bool trailingSlash = (pattern.size() > 1 && pattern.back() == '/');
+
+    // Split the pattern into its path components
+    vector<string_view> components;
+    for (size_t start = 0; start < pattern.size();)
+    {
+        size_t end = min(pattern.find('/', start), pattern.size());
+        if (end > start)
+            components.push_back(pattern.substr(start, end - start));
+        start = end + 1;
+    }
+
+    // Expand component by component, 'bases' holds the paths matched so far
+    vector<string> bases(1, (pattern[0] == '/') ? "/" : "");
+    bool checkExists = false;
+    for (size_t i = 0; i < components.size() && !bases.empty(); i++)
+    {
+        bool isLast = (i + 1 == components.size()) && !trailingSlash;
+        vector<string> next;
+
+        if (components[i] == "**")
+        {
+            for (const string &base : bases)
+                walkTree(base, isLast, next);
+            checkExists = false;
+            bases.swap(next);
+            continue;
+        }
+
+        GlobPattern component(components[i]);
+        if (component.isLiteral())
+        {
+            // Literal components are not looked up, the next directory read or the final check finds them
+            for (string &base : bases)
+                base = _joinPath(base, components[i]);
+            checkExists = true;
+            continue;
+        }
+
+        vector<DirEntry> entries;
+        for (const string &base : bases)
+        {
+            entries.clear();
+            if (!readDirectory(base.empty() ? "." : base, entries))
+                continue;
+            for (const DirEntry &entry : entries)
+            {
+                if ((isLast || entry.isDirectory) && component.matches(entry.name))
+                    next.push_back(_joinPath(base, entry.name));
+            }
+        }
+        checkExists = false;
+        bases.swap(next);
+    }
+
+    // Drop paths whose literal tail does not exist
+    vector<string> matches;
+    struct stat fileStat;
+    for (string &path : bases)
+    {
+        if (path.empty() || (checkExists && lstat(path.c_str(), &fileStat) != 0))
+            continue;
+        if (trailingSlash)
+            path += "/";
+        matches.push_back(move(path));
+    }
+
+    if (matches.empty())
+        return vector<string>(1, string(word));
+    sort(matches.begin(), matches.end());
+    matches.erase(unique(matches.begin(), matches.end()), matches.end());
+    return matches;
+}
+
+/* Reads all entries of a directory except '.' and '..' - the entry type saves a stat per name */
+bool GlobExpander::readDirectory(const string &path, vector<DirEntry> &entries)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    vector<char> buffer(GLOB_BUFFER_SIZE);
+    long nread;
+    while ((nread = syscall(SYS_getdents64, fd, buffer.data(), buffer.size())) > 0)
+    {
+        for (long bpos = 0; bpos < nread;)
+        {
+            linux_dirent64 *d = (linux_dirent64 *)(buffer.data() + bpos);
+            bpos += d->d_reclen;
+            if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+                continue;
+
+            bool isDirectory = (d->d_type == DT_DIR), isLink = (d->d_type == DT_LNK);
+            struct stat fileStat;
+            string fullPath;
+            if (d->d_type == DT_UNKNOWN)
+            {
+                fullPath = _joinPath(path, d->d_name);
+                bool exists = (lstat(fullPath.c_str(), &fileStat) == 0);
+                isDirectory = exists && S_ISDIR(fileStat.st_mode);
+                isLink = exists && S_ISLNK(fileStat.st_mode);
+            }
+            // Symbolic links to directories can be followed by a pattern, but not by '**'
+            if (isLink)
+            {
+                fullPath = _joinPath(path, d->d_name);
+                isDirectory = (stat(fullPath.c_str(), &fileStat) == 0 && S_ISDIR(fileStat.st_mode));
+            }
+            entries.push_back(DirEntry{d->d_name, isDirectory, isLink});
+        }
+    }
+
+    close(fd);
+    return nread == 0;
+}
+
+/* Collects the visible entries of one directory of a '**' walk, and the subdirectories still to walk */
+void GlobExpander::visitDirectory(const string &path, bool withFiles, vector<string> &subdirs, vector<string> &matches)
+{
+    vector<DirEntry> entries;
+    readDirectory(path.empty() ? "." : path, entries);
+    for (const DirEntry &entry : entries)
+    {
+        if (entry.name[0] == '.')
+            continue;
+
+        string fullPath = _joinPath(path, entry.name);
+        bool isDirectory = entry.isDirectory && !entry.isLink;
+        if (isDirectory)
+            subdirs.push_back(fullPath);
+        if (isDirectory || withFiles)
+            matches.push_back(move(fullPath));
+    }
+}
+
+/* Matches '**' under the base - every directory including the base itself, or every entry when it is
+ * the last component. The walk starts serially and is split across threads once the tree is large */
+void GlobExpander::walkTree(const string &base, bool withFiles, vector<string> &matches)
+{
+    if (!withFiles)
+        matches.push_back(base);
+    else if (!base.empty())
+        matches.push_back(_joinPath(base, ""));
+
+    vector<string> pending(1, base);
+    while (!pending.empty() && pending.size() < GLOB_PARALLEL_MIN_DIRS)
+    {
+        string path = move(pending.back());
+        pending.pop_back();
+        visitDirectory(path, withFiles, pending, matches);
+    }
+    if (pending.empty())
+        return;
+
+    TreeWalk walk;
+    walk.pending.swap(pending);
+    walk.busyWorkers = 0;
+    walk.withFiles = withFiles;
+
+    // This thread walks too, so the walk completes even if no thread could be started
+    int threadsNum = min((int)thread::hardware_concurrency(), GLOB_MAX_THREADS) - 1;
+    vector<thread> workers;
+    try
+    {
+        for (int i = 0; i < threadsNum; i++)
+            workers.push_back(thread(walkWorker, ref(walk)));
+    }
+    catch (const system_error &)
+    {
+    }
+    walkWorker(walk);
+    for (thread &worker : workers)
+        worker.join();
+
+    matches.insert(matches.end(), make_move_iterator(walk.matches.begin()), make_move_iterator(walk.matches.end()));
+}
+
+/* Takes directories off the shared walk until none are left and no worker can add more */
+void GlobExpander::walkWorker(TreeWalk &walk)
+{
+    unique_lock<mutex> lock(walk.lock);
+    while (true)
+    {
+        walk.changed.wait(lock, [&walk]() { return !walk.pending.empty() || walk.busyWorkers == 0; });
+        if (walk.pending.empty())
+            return;
+
+        string path = move(walk.pending.back());
+        walk.pending.pop_back();
+        walk.busyWorkers++;
+        lock.unlock();
+
+        vector<string> subdirs, matches;
+        visitDirectory(path, walk.withFiles, subdirs, matches);
+
+        lock.lock();
+        walk.busyWorkers--;
+        walk.pending.insert(walk.pending.end(), make_move_iterator(subdirs.begin()), make_move_iterator(subdirs.end()));
+        walk.matches.insert(walk.matches.end(), make_move_iterator(matches.begin()), make_move_iterator(matches.end()));
+        if (!subdirs.empty() || walk.busyWorkers == 0)
+            walk.changed.notify_all();
+    }
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------ Process Launcher ---------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+PathCache::PathCache() : m_pathValue(), m_directories(), m_hasRelativeDirectory(false), m_generation(0), m_entries() {}
+
+const char *PathCache::resolve(const char *name)
+{
+    // Paths are executed as given, only bare names are searched for
+    if (strchr(name, '/') != nullptr)
+        return name;
+    if (*name == '\0')
+    {
+        errno = ENOENT;
+        return nullptr;
+    }
+
+    const char *path = getenv("PATH");
+    string pathValue = (path != nullptr) ? path : DEFAULT_PATH;
+    if (m_directories.empty() || pathValue != m_pathValue)
+        setPathValue(pathValue);
+
+    Entry &entry = m_entries[name];
+    if (isValid(entry))
+    {
+        entry.hits++;
+        return entry.path.c_str();
+    }
+    if (isKnownMissing(entry))
+    {
+        entry.hits++;
+        errno = entry.error;
+        return nullptr;
+    }
+
+    // The directories are read before the search, a program added during it shows as a change
+    entry.misses++;
+    if (!m_hasRelativeDirectory)
+        refreshDirectories();
+    entry.generation = m_generation;
+    if (search(name, entry))
+    {
+        entry.error = 0;
+        return entry.path.c_str();
+    }
+    entry.path.clear();
+    entry.error = m_hasRelativeDirectory ? 0 : errno;
+    return nullptr;
+}
+
+void PathCache::clear()
+{
+    m_entries.clear();
+}
+
+/* Lists the commands by name with their hits and misses, as 'hash' does in other shells */
+void PathCache::print() const
+{
+    if (m_entries.empty())
+    {
+        cout << "smash hash: hash table empty" << endl;
+        return;
+    }
+    map<string, const Entry *> sorted;
+    for (const auto &entry : m_entries)
+        sorted[entry.first] = &entry.second;
+
+    cout << "hits\tmisses\tcommand" << endl;
+    for (const auto &entry : sorted)
+    {
+        const Entry &counts = *entry.second;
+        cout << setw(4) << counts.hits << "\t" << setw(6) << counts.misses << "\t"
+             << (counts.path.empty() ? entry.first : counts.path) << endl;
+    }
+}
+
+/* One stat of the directory - programs found through a relative PATH directory move with the working
+ * directory and are always searched for again */
+bool PathCache::isValid(const Entry &entry) const
+{
+    if (entry.path.empty() || entry.directory[0] != '/')
+        return false;
+    struct stat directoryStat;
+    return stat(entry.directory.c_str(), &directoryStat) == 0 &&
+           directoryStat.st_mtim.tv_sec == entry.directoryMtime.tv_sec &&
+           directoryStat.st_mtim.tv_nsec == entry.directoryMtime.tv_nsec;
+}
+
+/* A failed search still holds if no PATH directory changed since - one stat per directory instead of
+ * a lookup of the name in each of them */
+bool PathCache::isKnownMissing(const Entry &entry)
+{
+    if (entry.error == 0)
+        return false;
+    refreshDirectories();
+    return entry.generation == m_generation;
+}
+
+/* Walks PATH in order like execvp - the first regular file that may be executed wins. Finding only
+ * files without execute permission fails with EACCES rather than ENOENT */
+bool PathCache::search(const string &name, Entry &entry) const
+{
+    bool isDenied = false;
+    for (const Directory &directory : m_directories)
+    {
+        struct stat fileStat;
+        string path = directory.path + "/" + name;
+        if (stat(path.c_str(), &fileStat) < 0 || !S_ISREG(fileStat.st_mode))
+            continue;
+        if (access(path.c_str(), X_OK) < 0)
+        {
+            isDenied = true;
+            continue;
+        }
+
+        struct stat directoryStat;
+        if (stat(directory.path.c_str(), &directoryStat) < 0)
+            continue;
+        entry.path = path;
+        entry.directory = directory.path;
+        entry.directoryMtime = directoryStat.st_mtim;
+        return true;
+    }
+    errno = isDenied ? EACCES : ENOENT;
+    return false;
+}
+
+/* Splits the new PATH, an empty element is the working directory. Every entry is stale, their counts
+ * are kept */
+void PathCache::setPathValue(const string &pathValue)
+{
+    m_pathValue = pathValue;
+    m_directories.clear();
+    m_hasRelativeDirectory = false;
+    for (size_t start = 0; start <= pathValue.size();)
+    {
+        size_t end = pathValue.find(':', start);
+        end = (end == string::npos) ? pathValue.size() : end;
+        string directory = (end > start) ? pathValue.substr(start, end - start) : ".";
+        start = end + 1;
+
+        m_hasRelativeDirectory = m_hasRelativeDirectory || directory[0] != '/';
+        m_directories.push_back(Directory{directory, {0, 0}});
+    }
+    m_generation++;
+    for (auto &entry : m_entries)
+        entry.second.path.clear();
+}
+
+/* Stats every PATH directory and advances the generation if any of them changed */
+void PathCache::refreshDirectories()
+{
+    bool isChanged = false;
+    for (Directory &directory : m_directories)
+    {
+        struct stat directoryStat;
+        struct timespec mtime = {0, 0};
+        if (stat(directory.path.c_str(), &directoryStat) == 0)
+            mtime = directoryStat.st_mtim;
+        if (mtime.tv_sec != directory.mtime.tv_sec || mtime.tv_nsec != directory.mtime.tv_nsec)
+        {
+            directory.mtime = mtime;
+            isChanged = true;
+        }
+    }
+    if (isChanged)
+        m_generation++;
+}
+
+static LaunchBackend launchBackend = LAUNCH_SPAWN;
+static bool isLaunchTimed = false;
+static long execLatency = ERROR_VALUE;
+
+/* posix_spawn returns once the child has exec'd. A timed fork launch waits for the exec to close the
+ * child's copy of a close-on-exec pipe */
+pid_t Launcher::launch(const LaunchPlan &plan)
+{
+    if (!isLaunchTimed)
+        return (launchBackend == LAUNCH_SPAWN) ? spawn(plan) : forkExec(plan);
+
+    int execNotifyFds[2];
+    if (launchBackend == LAUNCH_FORK && pipe2(execNotifyFds, O_CLOEXEC) < 0)
+    {
+        perror("smash error: pipe failed");
+        return ERROR_VALUE;
+    }
+    auto start = chrono::steady_clock::now();
+    pid_t pid = (launchBackend == LAUNCH_SPAWN) ? spawn(plan) : forkExec(plan);
+    if (launchBackend == LAUNCH_FORK)
+    {
+        close(execNotifyFds[1]);
+        char byte;
+        while (read(execNotifyFds[0], &byte, 1) < 0 && errno == EINTR)
+            ;
+        close(execNotifyFds[0]);
+    }
+    execLatency = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    return pid;
+}
+
+void Launcher::setBackend(LaunchBackend backend)
+{
+    launchBackend = backend;
+}
+
+LaunchBackend Launcher::getBackend()
+{
+    return launchBackend;
+}
+
+void Launcher::setTiming(bool isTimed)
+{
+    isLaunchTimed = isTimed;
+    execLatency = ERROR_VALUE;
+}
+
+long Launcher::getExecLatency()
+{
+    return execLatency;
+}
+
+/* glibc's posix_spawn runs the child on the shell's memory (CLONE_VM | CLONE_VFORK) and reports a
+ * failed exec back to the parent */
+pid_t Launcher::spawn(const LaunchPlan &plan)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attributes);
+    for (const FdAction &action : plan.fdActions)
+    {
+        if (action.kind == FdAction::FD_DUP)
+            posix_spawn_file_actions_adddup2(&actions, action.source, action.fd);
+        else
+            posix_spawn_file_actions_addclose(&actions, action.fd);
+    }
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+
+    pid_t pid;
+    int error = posix_spawn(&pid, plan.path, &actions, &attributes, plan.argv, plan.envp);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if (error != 0)
+    {
+        errno = error;
+        perror("smash error: execvp failed");
+        return ERROR_VALUE;
+    }
+    return pid;
+}
+
+/* The child only applies the plan - nothing is allocated or looked up between the fork and the exec,
+ * and it never returns into the shell */
+pid_t Launcher::forkExec(const LaunchPlan &plan)
+{
+    pid_t pid = fork();
+    if (pid == ERROR_VALUE)
+    {
+        perror("smash error: fork failed");
+        return ERROR_VALUE;
+    }
+    if (pid != CHILD_ID)
+        return pid;
+
+    setpgid(0, 0);
+    for (const FdAction &action : plan.fdActions)
+    {
+        if (action.kind == FdAction::FD_CLOSE)
+            close(action.fd);
+        else if (dup2(action.source, action.fd) < 0)
+        {
+            perror("smash error: dup2 failed");
+            _exit(1);
+        }
+    }
+    execve(plan.path, plan.argv, plan.envp);
+    perror("smash error: execvp failed");
+    _exit(1);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Builtin Registry ----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+struct BuiltinEntry {
+    const char *name;
+    CommandFactory factory;     // nullptr for names that are only reserved
+};
+
+/* Commands are built in the line arena, they are destroyed (not deleted) before the line is released */
+template <class T, class... Args>
+Command *_newCommand(Args &&...args)
+{
+    void *memory = SmallShell::getInstance().getArena().allocate(sizeof(T), alignof(T));
+    return new (memory) T(std::forward<Args>(args)...);
+}
+
+template <class T>
+Command *_createCommand(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<T>(origin_cmd_line, ast);
+}
+
+template <>
+Command *_createCommand<ChangeDirCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<ChangeDirCommand>(origin_cmd_line, ast, SmallShell::getInstance().getPlastPwdPtr());
+}
+
+template <>
+Command *_createCommand<QuitCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<QuitCommand>(origin_cmd_line, ast, SmallShell::getInstance().getJobsList());
+}
+
+template <>
+Command *_createCommand<JobsCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<JobsCommand>(origin_cmd_line, ast, SmallShell::getInstance().getJobsList());
+}
+
+template <>
+Command *_createCommand<ForegroundCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<ForegroundCommand>(origin_cmd_line, ast, SmallShell::getInstance().getJobsList());
+}
+
+template <>
+Command *_createCommand<KillCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<KillCommand>(origin_cmd_line, ast, SmallShell::getInstance().getJobsList());
+}
+
+template <>
+Command *_createCommand<WatchCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<WatchCommand>(origin_cmd_line, ast, ast.isBackground);
+}
+
+template <>
+Command *_createCommand<ExternalCommand>(const char *origin_cmd_line, const CommandAST &ast)
+{
+    return _newCommand<ExternalCommand>(origin_cmd_line, ast, ast.isBackground);
+}
+
+/* Every builtin is registered here once - the table drives both dispatch and the reserved alias names */
+constexpr BuiltinEntry BUILTINS[] = {
+    {"chprompt", &_createCommand<ChangePromptCommand>},
+    {"showpid", &_createCommand<ShowPidCommand>},
+    {"pwd", &_createCommand<GetCurrDirCommand>},
+    {"cd", &_createCommand<ChangeDirCommand>},
+    {"jobs", &_createCommand<JobsCommand>},
+    {"fg", &_createCommand<ForegroundCommand>},
+    {"quit", &_createCommand<QuitCommand>},
+    {"kill", &_createCommand<KillCommand>},
+    {"alias", &_createCommand<aliasCommand>},
+    {"unalias", &_createCommand<unaliasCommand>},
+    {"listdir", &_createCommand<ListDirCommand>},
+    {"getuser", &_createCommand<GetUserCommand>},
+    {"watch", &_createCommand<WatchCommand>},
+    {"cache", &_createCommand<CacheCommand>},
+    {"hash", &_createCommand<HashCommand>},
+    {">", nullptr},
+    {"<", nullptr},
+    {"|", nullptr},
+};
+constexpr int BUILTINS_NUM = sizeof(BUILTINS) / sizeof(BUILTINS[0]);
+static_assert(BUILTINS_NUM < BUILTIN_TABLE_SIZE / 4, "builtin table is too crowded for a perfect hash - raise BUILTIN_TABLE_BITS");
+
+/* FNV-1a hash of a builtin name, the top bits select the slot in the table */
+constexpr uint32_t _hashName(const char *name, uint32_t hash)
+{
+    return (*name == '\0') ? hash : _hashName(name + 1, (hash ^ (unsigned char)*name) * FNV_PRIME);
+}
+
+constexpr uint32_t _builtinSlot(const char *name, uint32_t seed)
+{
+    return _hashName(name, seed) >> (32 - BUILTIN_TABLE_BITS);
+}
+
+constexpr int _collisionsWith(uint32_t seed, int i, int j)
+{
+    return (j == BUILTINS_NUM) ? 0 : (_builtinSlot(BUILTINS[i].name, seed) == _builtinSlot(BUILTINS[j].name, seed)) +
+                                         _collisionsWith(seed, i, j + 1);
+}
+
+constexpr int _countCollisions(uint32_t seed, int i = 0)
+{
+    return (i == BUILTINS_NUM) ? 0 : _collisionsWith(seed, i, i + 1) + _countCollisions(seed, i + 1);
+}
+
+/* The first seed from the FNV offset basis that gives every builtin its own slot */
+constexpr uint32_t _findPerfectSeed(uint32_t seed)
+{
+    return (_countCollisions(seed) == 0) ? seed : _findPerfectSeed(seed + 1);
+}
+
+constexpr uint32_t BUILTIN_HASH_SEED = _findPerfectSeed(FNV_OFFSET_BASIS);
+
+/* Index of the builtin that hashes to the slot, -1 for an empty slot */
+constexpr int _builtinAtSlot(uint32_t slot, int i = 0)
+{
+    return (i == BUILTINS_NUM) ? -1 : (_builtinSlot(BUILTINS[i].name, BUILTIN_HASH_SEED) == slot) ? i : _builtinAtSlot(slot, i + 1);
+}
+
+/* Slot table generated at compile time, one entry per slot */
+template <int... Slots>
+struct _SlotSequence {};
+
+template <int N, int... Slots>
+struct _MakeSlotSequence : _MakeSlotSequence<N - 1, N - 1, Slots...> {};
+
+template <int... Slots>
+struct _MakeSlotSequence<0, Slots...> {
+    typedef _SlotSequence<Slots...> type;
+};
+
+template <class Sequence>
+struct _BuiltinTable;
+
+template <int... Slots>
+struct _BuiltinTable<_SlotSequence<Slots...>> {
+    static constexpr int slots[BUILTIN_TABLE_SIZE] = {_builtinAtSlot(Slots)...};
+};
+
+template <int... Slots>
+constexpr int _BuiltinTable<_SlotSequence<Slots...>>::slots[BUILTIN_TABLE_SIZE];
+
+typedef _BuiltinTable<_MakeSlotSequence<BUILTIN_TABLE_SIZE>::type> BuiltinTable;
+
+/* Finds a registered builtin by name with a single table lookup, nullptr for other names */
+const BuiltinEntry *_findBuiltin(const char *name)
+{
+    int index = BuiltinTable::slots[_builtinSlot(name, BUILTIN_HASH_SEED)];
+    return (index != ERROR_VALUE && strcmp(BUILTINS[index].name, name) == 0) ? &BUILTINS[index] : nullptr;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*-------------------------------------------- Completion -------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+Completer::Completer() : m_listings(), m_path(), m_trie(1, TrieNode{{}, false}) {}
+
+/* Completes a command name at the start of a pipeline stage and a file name anywhere else. Candidates
+ * replace the whole word, paths keep their directory and directories end with '/' */
+void Completer::complete(const string &line, size_t cursor, const AliasTable &aliases, size_t &wordStart,
+                         vector<string> &matches)
+{
+    size_t start = min(cursor, line.size());
+    while (start > 0 && WHITESPACE.find(line[start - 1]) == string_view::npos && line[start - 1] != '|' &&
+           line[start - 1] != '>' && line[start - 1] != '&')
+        start--;
+    wordStart = start;
+    string word = line.substr(start, cursor - start);
+
+    string_view before = _rtrim(string_view(line).substr(0, start));
+    if ((before.empty() || before.back() == '|') && word.find('/') == string::npos)
+        completeCommand(word, aliases, matches);
+    else
+        completeFile(word, matches);
+
+    sort(matches.begin(), matches.end());
+    matches.erase(unique(matches.begin(), matches.end()), matches.end());
+}
+
+void Completer::completeCommand(const string &word, const AliasTable &aliases, vector<string> &matches)
+{
+    for (const BuiltinEntry &builtin : BUILTINS)
+        if (builtin.factory != nullptr && strncmp(builtin.name, word.c_str(), word.size()) == 0)
+            matches.push_back(builtin.name);
+    for (const AliasTable::Alias &alias : aliases.getAliases())
+        if (alias.name.compare(0, word.size(), word) == 0)
+            matches.push_back(alias.name);
+
+    // Walk the trie down the word, everything below is a match
+    updateCommandTrie();
+    uint32_t node = 0;
+    for (char c : word)
+    {
+        const vector<pair<char, uint32_t>> &children = m_trie[node].children;
+        auto child = find_if(children.begin(), children.end(), [c](const pair<char, uint32_t> &edge) { return edge.first == c; });
+        if (child == children.end())
+            return;
+        node = child->second;
+    }
+    string name = word;
+    collectCommands(node, name, matches);
+}
+
+void Completer::completeFile(const string &word, vector<string> &matches)
+{
+    size_t slash = word.rfind('/');
+    string directory = (slash == string::npos) ? "" : word.substr(0, slash + 1);
+    string prefix = word.substr(directory.size());
+
+    bool isChanged;
+    const Listing *listing = getListing(directory.empty() ? "." : directory, false, isChanged);
+    if (listing == nullptr)
+        return;
+    for (const Entry &entry : listing->entries)
+    {
+        // Hidden files only when asked for
+        if (entry.name.compare(0, prefix.size(), prefix) != 0 || (entry.name[0] == '.' && prefix.empty()))
+            continue;
+        matches.push_back(directory + entry.name + (entry.isDirectory ? "/" : ""));
+    }
+}
+
+/* Checks every PATH directory's mtime and rebuilds the trie when PATH or any of its directories changed.
+ * An unset PATH is searched as the launcher searches it */
+void Completer::updateCommandTrie()
+{
+    const char *path = getenv("PATH");
+    string pathValue = (path != nullptr) ? path : DEFAULT_PATH;
+    bool isChanged = (pathValue != m_path);
+
+    vector<const Listing *> listings;
+    for (size_t start = 0; start <= pathValue.size();)
+    {
+        size_t end = pathValue.find(':', start);
+        end = (end == string::npos) ? pathValue.size() : end;
+        string directory = pathValue.substr(start, end - start);
+        start = end + 1;
+
+        bool isListingChanged;
+        const Listing *listing = getListing(directory.empty() ? "." : directory, true, isListingChanged);
+        isChanged = isChanged || isListingChanged;
+        if (listing != nullptr)
+            listings.push_back(listing);
+    }
+    if (!isChanged)
+        return;
+
+    m_path = pathValue;
+    m_trie.assign(1, TrieNode{{}, false});
+    for (const Listing *listing : listings)
+        for (const Entry &entry : listing->entries)
+            if (entry.isExecutable)
+                insertCommand(entry.name);
+}
+
+void Completer::insertCommand(const string &name)
+{
+    uint32_t node = 0;
+    for (char c : name)
+    {
+        vector<pair<char, uint32_t>> &children = m_trie[node].children;
+        auto child = find_if(children.begin(), children.end(), [c](const pair<char, uint32_t> &edge) { return edge.first == c; });
+        if (child != children.end())
+        {
+            node = child->second;
+            continue;
+        }
+        uint32_t next = m_trie.size();
+        children.push_back({c, next});
+        m_trie.push_back(TrieNode{{}, false});
+        node = next;
+    }
+    m_trie[node].isName = true;
+}
+
+void Completer::collectCommands(uint32_t node, string &name, vector<string> &matches) const
+{
+    if (m_trie[node].isName)
+        matches.push_back(name);
+    for (const pair<char, uint32_t> &edge : m_trie[node].children)
+    {
+        name.push_back(edge.first);
+        collectCommands(edge.second, name, matches);
+        name.pop_back();
+    }
+}
+
+/* The cached listing of the directory, read again if its mtime changed. nullptr if it can't be read */
+const Completer::Listing *Completer::getListing(const string &path, bool withExecutable, bool &isChanged)
+{
+    isChanged = false;
+    struct stat dirStat;
+    auto cached = m_listings.find(path);
+    if (stat(path.c_str(), &dirStat) != 0 || !S_ISDIR(dirStat.st_mode))
+    {
+        isChanged = (cached != m_listings.end());
+        if (isChanged)
+            m_listings.erase(cached);
+        return nullptr;
+    }
+
+    if (cached != m_listings.end() && cached->second.mtime.tv_sec == dirStat.st_mtim.tv_sec &&
+        cached->second.mtime.tv_nsec == dirStat.st_mtim.tv_nsec && (cached->second.hasExecutable || !withExecutable))
+        return &cached->second;
+
+    Listing listing = {dirStat.st_mtim, withExecutable, {}};
+    if (!readListing(path, withExecutable, listing))
+        return nullptr;
+    isChanged = true;
+    return &(m_listings[path] = move(listing));
+}
+
+/* Reads up to COMPLETION_MAX_DIR_ENTRIES entries with getdents64. Only links and entries of unknown
+ * type are stat'ed, and executability is checked only when asked for */
+bool Completer::readListing(const string &path, bool withExecutable, Listing &listing)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    vector<char> buffer(GLOB_BUFFER_SIZE);
+    long nread;
+    while (listing.entries.size() < COMPLETION_MAX_DIR_ENTRIES &&
+           (nread = syscall(SYS_getdents64, fd, buffer.data(), buffer.size())) > 0)
+    {
+        for (long bpos = 0; bpos < nread && listing.entries.size() < COMPLETION_MAX_DIR_ENTRIES;)
+        {
+            linux_dirent64 *d = (linux_dirent64 *)(buffer.data() + bpos);
+            bpos += d->d_reclen;
+            if (strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+                continue;
+
+            bool isDirectory = (d->d_type == DT_DIR);
+            struct stat fileStat;
+            if (d->d_type == DT_LNK || d->d_type == DT_UNKNOWN)
+                isDirectory = (fstatat(fd, d->d_name, &fileStat, 0) == 0 && S_ISDIR(fileStat.st_mode));
+            bool isExecutable = withExecutable && !isDirectory && faccessat(fd, d->d_name, X_OK, 0) == 0;
+            listing.entries.push_back(Entry{d->d_name, isDirectory, isExecutable});
+        }
+    }
+
+    close(fd);
+    return true;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------ Rc Snapshot --------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Binary image of the state the rc file leaves behind - the prompt and the aliases in definition
+ * order, each string stored as its length and bytes. The header keys it by the rc file it came from */
+struct SnapshotHeader {
+    char magic[8];
+    uint64_t rcSize;
+    int64_t rcMtimeSec;
+    int64_t rcMtimeNsec;
+    uint32_t rcHash;
+    uint32_t aliasCount;
+};
+
+constexpr char SNAPSHOT_MAGIC[8] = {'S', 'M', 'A', 'S', 'H', 'R', 'C', '1'};
+
+struct RcSnapshot {
+    string_view prompt;
+    struct AliasRecord {
+        string_view name, command, display;
+    };
+    vector<AliasRecord> aliases;
+};
+
+uint32_t _hashBytes(string_view bytes)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+    for (char c : bytes)
+        hash = (hash ^ (unsigned char)c) * FNV_PRIME;
+    return hash;
+}
+
+/* Reads the whole file into 'text', false if it can't be read */
+bool _readFile(const string &path, string &text)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    char buffer[INPUT_BUFFER_SIZE];
+    ssize_t nread;
+    while ((nread = read(fd, buffer, sizeof(buffer))) != 0)
+    {
+        if (nread < 0 && errno == EINTR)
+            continue;
+        if (nread < 0)
+            break;
+        text.append(buffer, nread);
+    }
+    close(fd);
+    return nread == 0;
+}
+
+bool _readSnapshotString(const char *&pos, const char *end, string_view &value)
+{
+    uint32_t length;
+    if ((size_t)(end - pos) < sizeof(length))
+        return false;
+    memcpy(&length, pos, sizeof(length));
+    pos += sizeof(length);
+    if ((size_t)(end - pos) < length)
+        return false;
+    value = string_view(pos, length);
+    pos += length;
+    return true;
+}
+
+void _writeSnapshotString(string &image, string_view value)
+{
+    uint32_t length = value.size();
+    image.append((const char *)&length, sizeof(length));
+    image.append(value);
+}
+
+/* Checks the snapshot's key against the rc file and decodes the records. The views point into the
+ * mapping, the caller unmaps 'image' of 'imageSize' bytes once they are applied */
+bool _mapSnapshot(const string &path, const struct stat &rcStat, const string *rcText, RcSnapshot &snapshot,
+                  void *&image, size_t &imageSize)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    struct stat snapshotStat;
+    image = MAP_FAILED;
+    if (fstat(fd, &snapshotStat) == 0 && (size_t)snapshotStat.st_size >= sizeof(SnapshotHeader))
+    {
+        imageSize = snapshotStat.st_size;
+        image = mmap(nullptr, imageSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    if (image == MAP_FAILED)
+        return false;
+
+    // A touched rc file still matches if its contents hash the same
+    const SnapshotHeader *header = (const SnapshotHeader *)image;
+    bool isValid = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+                   header->rcSize == (uint64_t)rcStat.st_size &&
+                   ((header->rcMtimeSec == rcStat.st_mtim.tv_sec && header->rcMtimeNsec == rcStat.st_mtim.tv_nsec) ||
+                    (rcText != nullptr && header->rcHash == _hashBytes(*rcText)));
+
+    const char *pos = (const char *)image + sizeof(SnapshotHeader), *end = (const char *)image + imageSize;
+    isValid = isValid && _readSnapshotString(pos, end, snapshot.prompt);
+    for (uint32_t i = 0; isValid && i < header->aliasCount; i++)
+    {
+        RcSnapshot::AliasRecord record;
+        isValid = _readSnapshotString(pos, end, record.name) && _readSnapshotString(pos, end, record.command) &&
+                  _readSnapshotString(pos, end, record.display);
+        snapshot.aliases.push_back(record);
+    }
+
+    if (!isValid)
+        munmap(image, imageSize);
+    return isValid;
+}
+
+/* Replaces the snapshot with the given state. Written to a temporary file and renamed over the old
+ * one, so a concurrent startup sees either snapshot whole */
+void _saveSnapshot(const string &path, const struct stat &rcStat, const string &rcText, const string &prompt,
+                   const AliasTable &aliases)
+{
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.rcSize = rcStat.st_size;
+    header.rcMtimeSec = rcStat.st_mtim.tv_sec;
+    header.rcMtimeNsec = rcStat.st_mtim.tv_nsec;
+    header.rcHash = _hashBytes(rcText);
+    header.aliasCount = aliases.getAliases().size();
+
+    string image((const char *)&header, sizeof(header));
+    _writeSnapshotString(image, prompt);
+    for (const AliasTable::Alias &alias : aliases.getAliases())
+    {
+        _writeSnapshotString(image, alias.name);
+        _writeSnapshotString(image, alias.command);
+        _writeSnapshotString(image, alias.display);
+    }
+
+    string tempPath = path + ".XXXXXX";
+    int fd = mkstemp(&tempPath[0]);
+    if (fd < 0)
+        return;
+    size_t written = 0;
+    while (written < image.size())
     {
-        args[i] = (char *)malloc(s.length() + 1);
-        memset(args[i], 0, s.length() + 1);
-        strcpy(args[i], s.c_str());
-        args[++i] = NULL;
+        ssize_t result = write(fd, image.data() + written, image.size() - written);
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result < 0)
+            break;
+        written += result;
     }
-    return i;
-
-    FUNC_EXIT()
+    close(fd);
+    if (written != image.size() || rename(tempPath.c_str(), path.c_str()) != 0)
+        unlink(tempPath.c_str());
 }
 
-bool _isBackgroundCommand(const char *cmd_line)
+/* Commands whose whole effect can be the state kept in the snapshot. cd is left out, its result depends
+ * on the directory smash starts in */
+bool _isSnapshotCommand(CommandFactory factory)
 {
-    const string str(cmd_line);
-    return str[str.find_last_not_of(WHITESPACE)] == '&';
+    return factory == &_createCommand<aliasCommand> || factory == &_createCommand<unaliasCommand> ||
+           factory == &_createCommand<ChangePromptCommand>;
 }
 
-void _removeBackgroundSign(char *cmd_line)
-{
-    const string str(cmd_line);
+/* Passes everything written to it on to another stream buffer, counting the characters */
+class _CountingBuffer : public streambuf {
+public:
+    explicit _CountingBuffer(streambuf *target) : m_target(target), m_count(0) {}
 
-    // find last character other than spaces
-    unsigned int idx = str.find_last_not_of(WHITESPACE);
+    size_t getCount() const { return m_count; }
 
-    // if all characters are spaces / command line does not end with & / empty - then return
-    if (idx == string::npos || cmd_line[0] == '\0' || cmd_line[idx] != '&')
-        return;
+protected:
+    int overflow(int c) override
+    {
+        if (c == EOF)
+            return 0;
+        m_count++;
+        return m_target->sputc((char)c);
+    }
 
-    // replace the & (background sign) with space and then remove all tailing spaces.
-    cmd_line[idx] = '\0';
-}
+    streamsize xsputn(const char *text, streamsize count) override
+    {
+        m_count += count;
+        return m_target->sputn(text, count);
+    }
 
-string _removeBackgroundSignForString(string cmd)
-{
-    // find last character other than spaces
-    unsigned int idx = cmd.find_last_not_of(WHITESPACE);
+    int sync() override { return m_target->pubsync(); }
 
-    // if the command line does end with & then replace it
-    if (cmd[idx] == '&')
-        cmd.erase(idx);
-    return cmd;
-}
+private:
+    streambuf *m_target;
+    size_t m_count;
+};
 
 /*---------------------------------------------------------------------------------------------------*/
 /*----------------------------------------- SmallShell Class ----------------------------------------*/
 /*---------------------------------------------------------------------------------------------------*/
-const set<string> SmallShell::COMMANDS = {"chprompt", "showpid", "pwd", "cd", "jobs", "fg",
-"quit", "kill", "alias", "unalias", ">", "<", "|", "listdir", "getuser", "watch"};
-
 SmallShell::SmallShell() : m_fg_process(ERROR_VALUE), m_prompt("smash"), m_plastPwd(nullptr),
-                           m_jobList(new JobsList()), m_proceed(new bool(true)), m_stopWatch(false), m_alias(new map<string, string>),
-                           m_aliasToPrint(vector<string>()) {}
+                           m_jobList(nullptr), m_proceed(true), m_stopWatch(false), m_aliases(), m_arena(), m_commandCache(),
+                           m_completer(), m_pathCache(), m_lastStatus(0) {}
 
 SmallShell::~SmallShell()
 {
     if (m_plastPwd)
         free(m_plastPwd);
-    delete(m_proceed);
     delete m_jobList;
-    delete m_alias;
 }
 
 void SmallShell::setPrompt(const string str)
@@ -150,57 +1854,42 @@ pid_t SmallShell::getForegroundProcess() const
     return m_fg_process;
 }
 
+void SmallShell::setLastStatus(int status)
+{
+    m_lastStatus = status;
+}
+
+int SmallShell::getLastStatus() const
+{
+    return m_lastStatus;
+}
+
 bool SmallShell::toProceed() const
 {
-    return *m_proceed;
+    return m_proceed;
 }
 
 void SmallShell::quit()
 {
-    *m_proceed = false;
+    m_proceed = false;
 }
 
 void SmallShell::addAlias(string name, string command, string originCommand)
 {
-    int i =0;
-    if (m_alias->find(name) == m_alias->end() && COMMANDS.find(name) == COMMANDS.end())
-    {
-        (*m_alias)[name] = command;
-        m_aliasToPrint.push_back(name);
-        int equals = originCommand.find_first_of('='); // position of the '=' sign
-        string printCommand = originCommand.substr(equals, originCommand.size() - equals);
-        
-        // Find last ' show in string and saves new string until it
-        for (i = printCommand.size()-1; printCommand[i] != '\''; i--){}
-        printCommand = printCommand.substr(0, i+1);
-        m_aliasToPrint.push_back(printCommand);
-    }
-    else
+    // The definition is printed as written, from the '=' sign to the closing quote
+    size_t equals = originCommand.find('='), quote = originCommand.rfind('\'');
+    string display = originCommand.substr(equals, quote + 1 - equals);
+
+    if (_findBuiltin(name.c_str()) != nullptr || !m_aliases.insert(name, command, display))
         cerr << "smash error: alias: " << name << " already exists or is a reserved command" << endl;
 }
 
-void SmallShell::removeAlias(vector<string> args)
+void SmallShell::removeAlias(char *const *args, int argsNum)
 {
-    for (int i = 1; i < (int)args.size(); i++)
+    for (int i = 1; i < argsNum; i++)
     {
-        // checking if the arguments are aliases
-        auto it = m_alias->find(args[i]);
-        // case an argument is an alias
-        if (it != m_alias->end())
-        {
-            // finding the alias in the printing vector
-            auto aliasIt = find(m_aliasToPrint.begin(), m_aliasToPrint.end(), it->first);
-            // removing the match 'name', 'command' from the printing vector
-            if (aliasIt != m_aliasToPrint.end() && next(aliasIt) != m_aliasToPrint.end())
-            {
-                m_aliasToPrint.erase(next(aliasIt));
-                m_aliasToPrint.erase(aliasIt);
-            }
-            // removing the tuple (name,command) from the map
-            m_alias->erase(args[i]);
-        }
         // case an argument isn't an alias
-        else
+        if (!m_aliases.remove(args[i]))
         {
             cerr << "smash error: unalias: " << args[i] << " alias does not exist" << endl;
             break;
@@ -210,135 +1899,304 @@ void SmallShell::removeAlias(vector<string> args)
 
 void SmallShell::printAlias()
 {
-    // printing the aliases by the order of appending
-    for (int i = 0; i < (int)m_aliasToPrint.size(); i += 2)
-        cout << m_aliasToPrint[i] << m_aliasToPrint[i + 1] << endl;
-}
-
-char *SmallShell::extractCommand(const char *cmd_l, string &firstWord)
-{
-    // Make a modifiable copy of the command line and remove & if exists
-    char *newCmdLine = strdup(cmd_l);
-
-    _removeBackgroundSign(newCmdLine);
-
-    // Find first word (the command)
-    string cmd_s = _trim(string(newCmdLine));
-    firstWord = cmd_s.substr(0, cmd_s.find_first_of(" \n"));
-
-    if (m_alias->find(firstWord) != m_alias->end())
-    {
-        string command = m_alias->find(firstWord)->second, rest = "";
-
-        // Extract the rest of the command
-        if (firstWord.compare(cmd_s) != 0)
-            rest = cmd_s.substr(cmd_s.find_first_of(" \n"), cmd_s.find_first_of('\0'));
-
-        // build new command into newCmdLine & firstWord
-        cmd_s = command + rest;
-        firstWord = cmd_s.substr(0, cmd_s.find_first_of(" \n"));
-        copy(cmd_s.begin(), cmd_s.end(), newCmdLine);
-    }
-    return newCmdLine;
-}
-
-/* Creates and returns a pointer to Command class which matches the given command line (cmd_line) */
-Command *SmallShell::CreateCommand(const char *cmd_line){
-    string firstWord;
-    char *newCmdLine = extractCommand(cmd_line, firstWord);
-    // case the alias command is background, need to trim the '&'
-    bool isBg = _isBackgroundCommand(newCmdLine);
-    _removeBackgroundSign(newCmdLine);
-    if (firstWord.compare("alias") == 0)
-        return new aliasCommand(cmd_line, newCmdLine);
-    else if (string(newCmdLine).find('>') != string::npos)
-        return new RedirectionCommand(cmd_line, newCmdLine);
-    else if (string(newCmdLine).find('|') != string::npos)
-        return new PipeCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("pwd") == 0)
-        return new GetCurrDirCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("chprompt") == 0)
-        return new ChangePromptCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("showpid") == 0)
-        return new ShowPidCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("cd") == 0)
-        return new ChangeDirCommand(cmd_line, newCmdLine, getPlastPwdPtr());
-    else if (firstWord.compare("quit") == 0)
-        return new QuitCommand(cmd_line, newCmdLine, getJobsList());
-    else if (firstWord.compare("unalias") == 0)
-        return new unaliasCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("jobs") == 0)
-        return new JobsCommand(cmd_line, newCmdLine, getJobsList());
-    else if (firstWord.compare("fg") == 0)
-        return new ForegroundCommand(cmd_line, newCmdLine, getJobsList());
-    else if (firstWord.compare("kill") == 0)
-        return new KillCommand(cmd_line, newCmdLine, getJobsList());
-    else if (firstWord.compare("listdir") == 0)
-        return new ListDirCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("getuser") == 0)
-        return new GetUserCommand(cmd_line, newCmdLine);
-    else if (firstWord.compare("watch") == 0)
-        return new WatchCommand(cmd_line, newCmdLine, _isBackgroundCommand(cmd_line) || isBg);
-    else
-        return new ExternalCommand(cmd_line, newCmdLine, _isBackgroundCommand(cmd_line) || isBg);
+    m_aliases.print();
+}
 
-    return nullptr;
+void SmallShell::complete(const string &line, size_t cursor, size_t &wordStart, vector<string> &matches)
+{
+    m_completer.complete(line, cursor, m_aliases, wordStart, matches);
 }
 
-void SmallShell::executeCommand(const char *cmd_line)
+/* Runs the rc file, or restores the state it left behind from its snapshot. An rc file is snapshotted
+ * after it runs only if every line was an alias, unalias or chprompt that succeeded silently and changed
+ * the aliases or the prompt - a line with any other effect, output included, runs on every startup */
+void SmallShell::loadRcFile(const string &rcPath)
 {
-    Command *cmd = CreateCommand(cmd_line);
+    struct stat rcStat;
+    if (stat(rcPath.c_str(), &rcStat) != 0)
+        return;
+    string snapshotPath = rcPath + RC_SNAPSHOT_SUFFIX;
+
+    // Unchanged rc file - restore from the snapshot without reading the rc at all
+    RcSnapshot snapshot;
+    void *image;
+    size_t imageSize;
+    string rcText;
+    bool isRead = false;
+    bool isMapped = _mapSnapshot(snapshotPath, rcStat, nullptr, snapshot, image, imageSize);
+    if (!isMapped)
+    {
+        if (!_readFile(rcPath, rcText))
+        {
+            cerr << "smash error: " << rcPath << ": " << strerror(errno) << endl;
+            return;
+        }
+        isRead = true;
+        isMapped = _mapSnapshot(snapshotPath, rcStat, &rcText, snapshot, image, imageSize);
+    }
+    if (isMapped)
+    {
+        m_prompt = string(snapshot.prompt);
+        for (const RcSnapshot::AliasRecord &alias : snapshot.aliases)
+            m_aliases.insert(string(alias.name), string(alias.command), string(alias.display));
+        munmap(image, imageSize);
+
+        // Same contents under a new mtime - rekey the snapshot so the next startup skips the hash
+        if (isRead)
+            _saveSnapshot(snapshotPath, rcStat, rcText, m_prompt, m_aliases);
+        return;
+    }
 
-    // Remove all finshed background jobs.
-    m_jobList->removeFinishedJobs();
+    // Run the rc line by line, '#' starts a comment line
+    bool isSnapshotable = true;
+    for (size_t start = 0; start < rcText.size() && toProceed();)
+    {
+        size_t end = rcText.find('\n', start);
+        end = (end == string::npos) ? rcText.size() : end;
+        string line = rcText.substr(start, end - start);
+        start = end + 1;
+        if (_ltrim(line).empty() || _ltrim(line).substr(0, 1) == "#")
+            continue;
 
-    // Invalid Command
-    if (cmd == nullptr){
-        printToTerminal("Unknown Command");
-        return;
+        ArenaScope scope(m_arena);
+        CommandAST ast = parseCommandLine(line.c_str(), m_arena);
+        CommandFactory factory = resolveCommand(ast);
+        if (!isSnapshotable || !_isSnapshotCommand(factory))
+        {
+            isSnapshotable = false;
+            executeCommand(line.c_str(), ast, factory);
+            continue;
+        }
+
+        // The line's output is counted on its way to the terminal
+        string prompt = m_prompt;
+        unsigned long generation = m_aliases.getGeneration();
+        _CountingBuffer outCounter(cout.rdbuf()), errCounter(cerr.rdbuf());
+        streambuf *out = cout.rdbuf(&outCounter);
+        streambuf *err = cerr.rdbuf(&errCounter);
+        executeCommand(line.c_str(), ast, factory);
+        cout.rdbuf(out);
+        cerr.rdbuf(err);
+
+        bool isChanged = (m_prompt != prompt || m_aliases.getGeneration() != generation);
+        isSnapshotable = (getLastStatus() == 0 && outCounter.getCount() == 0 && errCounter.getCount() == 0 && isChanged);
     }
 
-    if (cmd->isExternalCommand()){
-        // Fork a new process
-        pid_t pid = fork();
+    if (isSnapshotable)
+        _saveSnapshot(snapshotPath, rcStat, rcText, m_prompt, m_aliases);
+    else
+        unlink(snapshotPath.c_str());
+}
 
-        if (pid == ERROR_VALUE)
+/* Parses the command line once into an AST in the given arena - expands aliases, splits pipeline
+ * stages and redirections */
+CommandAST SmallShell::parseCommandLine(const char *cmd_line, Arena &arena)
+{
+    CommandAST ast(arena);
+    string_view line = cmd_line;
+    ast.isBackground = _isBackgroundCommand(line);
+    line = _removeBackgroundSign(line);
+
+    // Expand alias of the first word (and the aliases its body starts with), the alias itself may
+    // be a background command
+    string_view firstWord = _firstWord(line);
+    string_view rest;
+    const AliasTable::Alias *alias = m_aliases.resolve(firstWord);
+    if (alias != nullptr)
+    {
+        string_view body = alias->resolved;
+        rest = _rtrim(_ltrim(line).substr(firstWord.size()));
+        char *text = (char *)arena.allocate(body.size() + rest.size() + 1, 1);
+        memcpy(text, body.data(), body.size());
+        memcpy(text + body.size(), rest.data(), rest.size());
+
+        line = string_view(text, body.size() + rest.size());
+        ast.isBackground = _isBackgroundCommand(line) || ast.isBackground;
+        line = _removeBackgroundSign(line);
+        text[line.size()] = '\0';
+        ast.text = text;
+        firstWord = _firstWord(line);
+    }
+    else
+        ast.text = arena.copyString(line.data(), line.size());
+    line = string_view(ast.text, line.size());
+
+    ast.stages.push_back(CommandStage(arena));
+
+    // The alias command keeps its operators as part of the alias body
+    if (firstWord == "alias")
+    {
+        for (string_view rest = _ltrim(line); !rest.empty();)
         {
-            perror("smash error: fork failed");
-            delete cmd;
-            return;
+            string_view word = _firstWord(rest);
+            ast.stages[0].words.push_back(arena.copyString(word.data(), word.size()));
+            rest = _ltrim(rest.substr(word.size()));
         }
+        return ast;
+    }
 
-        // Child process
-        if (pid == CHILD_ID)
-            setpgrp();
+    // An alias is spliced in as its pre-lexed tokens, only the rest of the line is lexed
+    ArenaVector<Token> tokens((ArenaAllocator<Token>(arena)));
+    size_t expandedUntil = 0; // tokens before this index were spliced from an alias body
+    if (alias != nullptr)
+    {
+        _spliceAliasTokens(alias->resolvedTokens, tokens, 0, arena);
+        ArenaVector<Token> restTokens = _lexCommandLine(rest, arena);
+        tokens.insert(tokens.end(), restTokens.begin(), restTokens.end());
+    }
+    else
+        tokens = _lexCommandLine(line, arena);
 
-        // Parent process
-        if (pid > CHILD_ID)
+    for (size_t i = 0; i < tokens.size(); i++)
+    {
+        CommandStage &stage = ast.stages.back();
+
+        if (tokens[i].type == TOKEN_WORD)
         {
-            if (cmd->isBackgroundCommand())
-                getJobsList()->addJob(cmd, pid);
-            else
+            // Expand alias at the start of every following pipeline stage
+            if (stage.words.empty() && ast.stages.size() > 1 && i >= expandedUntil &&
+                m_aliases.find(tokens[i].text) != nullptr)
             {
-                // Set process in as foreground process
-                setForegroundProcess(pid);
+                const AliasTable::Alias *stageAlias = m_aliases.resolve(tokens[i].text);
+                tokens.erase(tokens.begin() + i);
+                expandedUntil = i + _spliceAliasTokens(stageAlias->resolvedTokens, tokens, i, arena);
+                i--;
+                continue;
+            }
+            stage.words.push_back(tokens[i].text);
+        }
+        else if (tokens[i].type == TOKEN_REDIRECT || tokens[i].type == TOKEN_REDIRECT_APPEND)
+        {
+            stage.hasRedirection = true;
+            stage.isAppend = (tokens[i].type == TOKEN_REDIRECT_APPEND);
+            if (i + 1 < tokens.size() && tokens[i + 1].type == TOKEN_WORD)
+                stage.redirectTarget = tokens[++i].text;
+        }
+        else if (tokens[i].type == TOKEN_PIPE || tokens[i].type == TOKEN_PIPE_ERR)
+        {
+            stage.isPipeErr = (tokens[i].type == TOKEN_PIPE_ERR);
+            ast.stages.push_back(CommandStage(arena));
+        }
+    }
+    return ast;
+}
+
+/* Creates and returns a pointer to Command class which matches the given command line (cmd_line).
+   The command lives in the line arena - it is destroyed with its destructor, never deleted */
+Command *SmallShell::CreateCommand(const char *cmd_line)
+{
+    return CreateCommand(cmd_line, parseCommandLine(cmd_line, m_arena));
+}
+
+/* Creates and returns a pointer to Command class which matches the given parsed command line */
+Command *SmallShell::CreateCommand(const char *origin_cmd_line, const CommandAST &ast)
+{
+    CommandFactory factory = resolveCommand(ast);
+    return (factory != nullptr) ? factory(origin_cmd_line, ast) : nullptr;
+}
 
-                int status;
-                waitpid(pid, &status, 0);
+/* Decides which command class the parsed command line dispatches to, nullptr for an empty command */
+CommandFactory SmallShell::resolveCommand(const CommandAST &ast) const
+{
+    const char *firstWord = ast.firstWord();
+    if (strcmp(firstWord, "alias") == 0)
+        return &_createCommand<aliasCommand>;
+    else if (ast.stages.size() > 1)
+        return &_createCommand<PipeCommand>;
+    else if (ast.stages[0].hasRedirection)
+        return &_createCommand<RedirectionCommand>;
+    else if (firstWord[0] == '\0')
+        return nullptr;
 
-                // Set foreground process as empty
-                setForegroundProcess(ERROR_VALUE);
+    // Builtin commands are looked up in the registry, anything else is external
+    const BuiltinEntry *builtin = _findBuiltin(firstWord);
+    if (builtin != nullptr && builtin->factory != nullptr)
+        return builtin->factory;
+    return &_createCommand<ExternalCommand>;
+}
 
-                // Free allocated memory from parent process
-                delete cmd;
-            }
+void SmallShell::executeCommand(const char *cmd_line)
+{
+#if ARENA_STATS
+    size_t allocations = m_arena.getAllocationCount(), blocks = m_arena.getBlockCount();
+    size_t heapAllocations = _heapAllocations;
+#endif
+
+    // Everything built for this line is released when the command finishes, only the plan is kept
+    {
+        ArenaScope scope(m_arena);
+        // Plans are cached per alias generation, they are expanded with the aliases of their time.
+        // The plan is held until the command finishes, even if a nested command line evicts it
+        shared_ptr<CommandPlan> plan = m_commandCache.find(cmd_line, m_aliases.getGeneration());
+        if (plan != nullptr)
+            executeCommand(cmd_line, plan->ast, plan->factory);
+        else
+        {
+            // A new line is parsed into the line arena, the cache keeps a copy in memory it recycles
+            CommandAST ast = parseCommandLine(cmd_line, m_arena);
+            CommandFactory factory = resolveCommand(ast);
+            if (!_trim(cmd_line).empty())
+                m_commandCache.insert(cmd_line, m_aliases.getGeneration(), ast, factory);
+            executeCommand(cmd_line, ast, factory);
+        }
+    }
+
+#if ARENA_STATS
+    // Read before printing, the stream may allocate
+    size_t lineHeapAllocations = _heapAllocations - heapAllocations;
+    cerr << "smash arena: " << m_arena.getAllocationCount() - allocations << " allocations, "
+         << m_arena.getBlockCount() - blocks << " new blocks, " << lineHeapAllocations << " mallocs" << endl;
+#endif
+}
+
+void SmallShell::executeCommand(const char *origin_cmd_line, const CommandAST &ast)
+{
+    executeCommand(origin_cmd_line, ast, resolveCommand(ast));
+}
+
+void SmallShell::executeCommand(const char *origin_cmd_line, const CommandAST &ast, CommandFactory factory)
+{
+    // Empty command line - nothing to execute
+    if (ast.isEmpty())
+    {
+        if (m_jobList != nullptr)
+            m_jobList->removeFinishedJobs();
+        return;
+    }
+
+    Command *cmd = (factory != nullptr) ? factory(origin_cmd_line, ast) : nullptr;
+
+    // Remove all finshed background jobs - there are none before the first job list use
+    if (m_jobList != nullptr)
+        m_jobList->removeFinishedJobs();
+
+    // Invalid Command
+    if (cmd == nullptr){
+        printToTerminal("Unknown Command");
+        setLastStatus(1);
+        return;
+    }
+
+    // Background programs are started and handed to the job list
+    if (cmd->isExternalCommand() && cmd->isBackgroundCommand())
+    {
+        pid_t pid = static_cast<ExternalCommand *>(cmd)->launch();
+        if (pid == ERROR_VALUE)
+        {
+            setLastStatus(1);
+            cmd->~Command();
             return;
         }
+        getJobsList()->addJob(cmd, pid);
+        setLastStatus(0);
+        cmd->~Command();
+        return;
     }
 
-    // Execute command
+    // Execute command - commands that wait for a process report its status themselves
+    setLastStatus(0);
     cmd->execute();
-    delete cmd;
+    cmd->~Command();
 }
 
 /* Gets pointer to the last path of working directory */
@@ -353,11 +2211,29 @@ void SmallShell::setPlastPwdPtr(char *newPwd)
     m_plastPwd = newPwd;
 }
 
+/* The job list is created on first use, most short-lived shells never need it */
 JobsList *SmallShell::getJobsList()
 {
+    if (m_jobList == nullptr)
+        m_jobList = new JobsList();
     return m_jobList;
 }
 
+Arena &SmallShell::getArena()
+{
+    return m_arena;
+}
+
+CommandCache &SmallShell::getCommandCache()
+{
+    return m_commandCache;
+}
+
+PathCache &SmallShell::getPathCache()
+{
+    return m_pathCache;
+}
+
 /* Prints give line to terminal */
 void SmallShell::printToTerminal(string line)
 {
@@ -368,63 +2244,45 @@ void SmallShell::printToTerminal(string line)
 /*-------------------------------------- General Command Class --------------------------------------*/
 /*---------------------------------------------------------------------------------------------------*/
 /* C'tor & D'tor for Command Class*/
-Command::Command(const char *origin_cmd_line, const char *cmd_line, bool isBgCmd) : m_origin_cmd_string(string(origin_cmd_line)),
-                                                                                    m_cmd_string(string(cmd_line)), m_bgCmd(isBgCmd){
-    // Free allocated memory in extract command
-    if (cmd_line)
-        free(const_cast<char *>(cmd_line));
+Command::Command(const char *origin_cmd_line, const CommandAST &ast, bool isBgCmd) : m_origin_cmd_string(origin_cmd_line),
+                                                                                      m_cmd_string(ast.text), m_args(),
+                                                                                      m_bgCmd(isBgCmd){
+    // Arguments of the command are the words of the first stage
+    if (!ast.stages.empty())
+    {
+        for (char *word : ast.stages[0].words)
+            m_args.push(word);
+    }
 }
 
 Command::~Command() {}
 
-/* Method to count the number of arguments, assuming arguments are space-separated */
+/* Method to count the number of arguments */
 int Command::getArgCount() const
 {
-    int count = 0;
-    const char *cmd = m_cmd_string.c_str(); // m_cmd_string holds the command string
-    while (*cmd != '\0')
-    {
-        if (*cmd != ' ')
-        {
-            count++;
-
-            while (*cmd != ' ' && *cmd != '\0') // Skip to the next argument
-                cmd++;
-        }
-        else
-            cmd++;
-    }
-
-    return count;
+    return m_args.size();
 }
 
-/* Method to get the command arguments as a vector */
-vector<string> Command::getArgs() const
+/* Method to get the NULL terminated command arguments, as tokenized by the parser */
+char *const *Command::getArgs() const
 {
-    vector<string> arguments;
-    string cmdLine(m_cmd_string); //  m_cmd_string holds the command line
-
-    // Tokenize the command line based on spaces
-    istringstream iss(cmdLine);
-    for (string arg; iss >> arg;)
-        arguments.push_back(arg);
-
-    return arguments;
+    return m_args.data();
 }
 
-string Command::getCommand() const
+const char *Command::getCommand() const
 {
     return m_cmd_string;
 }
 
-string Command::getOriginalCommand() const
+const char *Command::getOriginalCommand() const
 {
     return m_origin_cmd_string;
 }
 
-void Command::setCommand(string cmd)
+/* The new text is copied into the line arena */
+void Command::setCommand(string_view cmd)
 {
-    m_cmd_string = cmd;
+    m_cmd_string = SmallShell::getInstance().getArena().copyString(cmd.data(), cmd.size());
 }
 
 bool Command::isBackgroundCommand() const
@@ -440,10 +2298,10 @@ bool Command::isExternalCommand() const{
 /*---------------------------------------- Built-in Commands ----------------------------------------*/
 /*---------------------------------------------------------------------------------------------------*/
 /* C'tor for BuiltInCommand Class*/
-BuiltInCommand::BuiltInCommand(const char *origin_cmd_line, const char *cmd_line) : Command(origin_cmd_line, cmd_line) {}
+BuiltInCommand::BuiltInCommand(const char *origin_cmd_line, const CommandAST &ast) : Command(origin_cmd_line, ast) {}
 
 /* Constructor implementation for GetCurrDirCommand */
-GetCurrDirCommand::GetCurrDirCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line) {}
+GetCurrDirCommand::GetCurrDirCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
 
 /* Execute method to get and print the current working directory. */
 void GetCurrDirCommand::execute()
@@ -454,7 +2312,7 @@ void GetCurrDirCommand::execute()
 }
 
 /* C'tor for changePromptCommand*/
-ChangePromptCommand::ChangePromptCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line) {}
+ChangePromptCommand::ChangePromptCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
 
 void ChangePromptCommand::execute()
 {
@@ -464,7 +2322,7 @@ void ChangePromptCommand::execute()
 }
 
 /* C'tor for ShowPidCommand Class*/
-ShowPidCommand::ShowPidCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line) {}
+ShowPidCommand::ShowPidCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
 
 void ShowPidCommand::execute()
 {
@@ -473,11 +2331,11 @@ void ShowPidCommand::execute()
 }
 
 /* C'tor for quit command*/
-QuitCommand::QuitCommand(const char *origin_cmd_line, const char *cmd_line, JobsList *jobs) : BuiltInCommand(origin_cmd_line, cmd_line), m_jobsList(jobs) {}
+QuitCommand::QuitCommand(const char *origin_cmd_line, const CommandAST &ast, JobsList *jobs) : BuiltInCommand(origin_cmd_line, ast), m_jobsList(jobs) {}
 
 void QuitCommand::execute()
 {
-    if (getArgCount() > 1 && getArgs()[1].compare("kill") == 0)
+    if (getArgCount() > 1 && strcmp(getArgs()[1], "kill") == 0)
     {
         // Print a message & joblist before exiting
         if (m_jobsList != nullptr){
@@ -496,65 +2354,35 @@ void QuitCommand::execute()
 }
 
 /* C'tor for aliasCommamd class */
-aliasCommand::aliasCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line)
+aliasCommand::aliasCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast),
+                                                                                 m_name(), m_command(), m_isValid(false)
 {
-    unsigned int space = 0, equals = 0;
-    for (; space < m_cmd_string.length() && m_cmd_string[space] != ' '; space++)
-    {
-    }
-    equals = space;
-    for (; equals < m_cmd_string.length() && m_cmd_string[equals] != '='; equals++)
-    {
-    }
-
-    int length = m_cmd_string.length() - equals - 3;
-    char command[length + 1];
-
-    for (int i = 0; i < length; i++)
-        command[i] = m_cmd_string[equals + 2 + i];
-
-    command[length] = '\0';
-    // trimming the command line from '&' and ' '
-    int j = 1;
-    while (command[length - j] == '\'' || command[length - j] == ' ')
+    // Validate and split the definition once, the views point into the command string
+    string_view name, body;
+    m_isValid = _parseAliasDefinition(_trim(m_cmd_string), name, body);
+    if (m_isValid)
     {
-        command[length - j] = '\0';
-        j++;
+        m_name = string(name);
+        m_command = string(body);
     }
-
-    length = equals - space - 1;
-
-    char name[length + 1];
-    for (int i = 0; i < length; i++)
-        name[i] = m_cmd_string[space + 1 + i];
-
-    name[length] = '\0';
-    m_name = name;
-    m_command = command;
 }
 
 void aliasCommand::execute()
 {
-    const regex aliasRegex("^alias [a-zA-Z0-9_]+='[^']*'$");
     SmallShell &smash = SmallShell::getInstance();
     // Print alias commands list
     if (getArgCount() == 1)
         smash.printAlias();
 
     // Add new alias command
+    else if (m_isValid)
+        smash.addAlias(m_name, m_command, m_origin_cmd_string);
     else
-    {
-        m_cmd_string = _trim(m_cmd_string);
-        string first = m_command.substr(0, m_command.find_first_of(" \n"));
-        if (regex_match(m_cmd_string, aliasRegex))
-            smash.addAlias(m_name, m_command, m_origin_cmd_string);
-        else
-            cerr << "smash error: alias: invalid alias format" << endl;
-    }
+        cerr << "smash error: alias: invalid alias format" << endl;
 }
 
 /* C'tor for unaliasCommand class. */
-unaliasCommand::unaliasCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line) {}
+unaliasCommand::unaliasCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
 
 void unaliasCommand::execute()
 {
@@ -564,11 +2392,41 @@ void unaliasCommand::execute()
         cerr << "smash error: unalias: not enough arguments" << endl;
     }
     else
-        smash.removeAlias(getArgs());
+        smash.removeAlias(getArgs(), getArgCount());
+}
+
+/* C'tor for CacheCommand class. */
+CacheCommand::CacheCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
+
+/* Prints the command cache, 'cache -r' flushes it */
+void CacheCommand::execute()
+{
+    CommandCache &cache = SmallShell::getInstance().getCommandCache();
+    if (getArgCount() == 1)
+        cache.print();
+    else if (getArgCount() == 2 && strcmp(getArgs()[1], "-r") == 0)
+        cache.clear();
+    else
+        cerr << "smash error: cache: invalid arguments" << endl;
+}
+
+/* C'tor for HashCommand class. */
+HashCommand::HashCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
+
+/* Prints the PATH lookup cache, 'hash -r' forgets every lookup */
+void HashCommand::execute()
+{
+    PathCache &cache = SmallShell::getInstance().getPathCache();
+    if (getArgCount() == 1)
+        cache.print();
+    else if (getArgCount() == 2 && strcmp(getArgs()[1], "-r") == 0)
+        cache.clear();
+    else
+        cerr << "smash error: hash: invalid arguments" << endl;
 }
 
 /* Constructor implementation for ChangeDirCommand */
-ChangeDirCommand::ChangeDirCommand(const char *origin_cmd_line, const char *cmd_line, char *plastPwd) : BuiltInCommand(origin_cmd_line, cmd_line), plastPwd(plastPwd) {}
+ChangeDirCommand::ChangeDirCommand(const char *origin_cmd_line, const CommandAST &ast, char *plastPwd) : BuiltInCommand(origin_cmd_line, ast), plastPwd(plastPwd) {}
 
 ChangeDirCommand::~ChangeDirCommand(){
     free(plastPwd);
@@ -584,7 +2442,7 @@ void ChangeDirCommand::execute()
     // 1 argument - go to the given directory
     if (getArgCount() == CD_COMMAND_ARGS_NUM)
     {
-        if (getArgs()[1] == "-")
+        if (strcmp(getArgs()[1], "-") == 0)
         {
             if (plastPwd != nullptr){
                 newDir = plastPwd;
@@ -596,12 +2454,12 @@ void ChangeDirCommand::execute()
                 return;
             }
         }
-        else if (getArgs()[1] == ".."){
+        else if (strcmp(getArgs()[1], "..") == 0){
             newDir = dirname(getcwd(NULL, 0));
             freeNewDir = true;
         }
         else{
-            newDir = strdup(getArgs()[1].c_str());
+            newDir = strdup(getArgs()[1]);
             freeNewDir = true;
         }
     }
@@ -631,21 +2489,21 @@ void ChangeDirCommand::execute()
         free(newDir);
 }
 
-JobsCommand::JobsCommand(const char *origin_cmd_line, const char *cmd_line, JobsList *jobs) : BuiltInCommand(origin_cmd_line, cmd_line), m_jobsList(jobs) {}
+JobsCommand::JobsCommand(const char *origin_cmd_line, const CommandAST &ast, JobsList *jobs) : BuiltInCommand(origin_cmd_line, ast), m_jobsList(jobs) {}
 
 void JobsCommand::execute()
 {
     m_jobsList->printJobsList();
 }
 
-ForegroundCommand::ForegroundCommand(const char *origin_cmd_line, const char *cmd_line, JobsList *jobs) : BuiltInCommand(origin_cmd_line, cmd_line), m_jobsList(jobs) {}
+ForegroundCommand::ForegroundCommand(const char *origin_cmd_line, const CommandAST &ast, JobsList *jobs) : BuiltInCommand(origin_cmd_line, ast), m_jobsList(jobs) {}
 
 void ForegroundCommand::execute()
 {
     SmallShell &smash = SmallShell::getInstance();
     int jobID;
 
-    if (getArgs().size() == 2)
+    if (getArgCount() == 2)
     {
         try
         {
@@ -667,7 +2525,7 @@ void ForegroundCommand::execute()
     }
 
     // No job ID specified, select the job with the maximum job ID
-    else if (getArgs().size() == 1)
+    else if (getArgCount() == 1)
     {
         // Check if the jobs list is empty
         if (m_jobsList->isEmpty())
@@ -687,37 +2545,38 @@ void ForegroundCommand::execute()
     // Get the job, sets him as forground and remove it from the jobs list and prints the requested message
     JobsList::JobEntry *jobEntry = m_jobsList->getJobById(jobID);
     int jobPid = jobEntry->getProcessID();
-    cout << jobEntry->getCommand()->getCommand() << " " << jobPid << endl;
+    cout << jobEntry->getCommand() << " " << jobPid << endl;
     smash.setForegroundProcess(m_jobsList->getJobById(jobID)->getProcessID());
     m_jobsList->removeJobById(jobID);
 
     // Wait for the process to finish, bringing it to the foreground
     int status;
     waitpid(jobPid, &status, 0);
+    smash.setLastStatus(_exitStatus(status));
 
     // No job in foreground
     smash.setForegroundProcess(ERROR_VALUE);
 }
 
 /* Constructor implementation for KillCommand */
-KillCommand::KillCommand(const char *origin_cmd_line, const char *cmd_line, JobsList *jobs) : BuiltInCommand(origin_cmd_line, cmd_line), m_jobsList(jobs) {}
+KillCommand::KillCommand(const char *origin_cmd_line, const CommandAST &ast, JobsList *jobs) : BuiltInCommand(origin_cmd_line, ast), m_jobsList(jobs) {}
 
 /* Execute method to kill given jobID. */
 void KillCommand::execute(){
-    vector<string> args = getArgs();
+    char *const *args = getArgs();
     int signum, jobID;
     JobsList::JobEntry *jobEntry;
 
     // Get valid jobID
     try{
-        if (args.size() > 2){
+        if (getArgCount() > 2){
             jobID = stoi(args[2]);
             signum = stoi(args[1]);
             signum = signum < MIN_SIGNUM ? -signum : throw InvalidArgument();
         }
 
         // Validate the number of arguments
-        if (args.size() != 3 || jobID < DEFAULT_JOB_ID)
+        if (getArgCount() != 3 || jobID < DEFAULT_JOB_ID)
             throw InvalidArgument();
     }
     catch (...)
@@ -744,70 +2603,93 @@ void KillCommand::execute(){
 /*---------------------------------------------------------------------------------------------------*/
 
 /* Constructor implementation for ExternalCommand */
-ExternalCommand::ExternalCommand(const char *origin_cmd_line, const char *cmd_line, bool isBgCmd) : Command(origin_cmd_line, cmd_line, isBgCmd)
+ExternalCommand::ExternalCommand(const char *origin_cmd_line, const CommandAST &ast, bool isBgCmd) : Command(origin_cmd_line, ast, isBgCmd)
 {
     if (isBgCmd)
-        setCommand(getCommand() + "&");
+    {
+        size_t length = strlen(m_cmd_string);
+        char *text = (char *)SmallShell::getInstance().getArena().allocate(length + 2, 1);
+        memcpy(text, m_cmd_string, length);
+        memcpy(text + length, "&", 2);
+        m_cmd_string = text;
+    }
 }
 
-/* Execute method to an external command. */
 void ExternalCommand::execute()
 {
-    // Check if the command line contains special characters like '*' or '?'
-    string cmd = getCommand();
-    cmd = _removeBackgroundSignForString(cmd);
-
-    // Check for Simple/Complex command
-    if (cmd.find_first_of("*?") != string::npos)
-        runComplexCommand(cmd);
-    else
-        runSimpleCommand(cmd);
+    runInForeground(vector<FdAction>());
 }
 
-void ExternalCommand::runSimpleCommand(const string &cmd)
+/* Starts the program with the given changes to its descriptors and waits for it */
+void ExternalCommand::runInForeground(const vector<FdAction> &fdActions)
 {
-    // Split command into tokens (command and arguments)
-    vector<string> tokens = splitCommand(cmd);
-
-    // Construct argument array for execvp
-    char *args[tokens.size() + 1];
-    for (size_t i = 0; i < tokens.size(); ++i)
+    SmallShell &smash = SmallShell::getInstance();
+    pid_t pid = launch(fdActions);
+    if (pid == ERROR_VALUE)
     {
-        args[i] = strdup(tokens[i].c_str());
+        smash.setLastStatus(1);
+        return;
     }
-    args[tokens.size()] = nullptr;
-
-    // Free allocated memory from parent process
-    delete this;
 
-    // Execute the command using execvp
-    execvp(args[0], args);
-
-    // Handle execvp failure
-    perror("smash error: execvp failed");
-    exit(1);
+    // The foreground process is the one ctrl-C kills
+    smash.setForegroundProcess(pid);
+    int status;
+    waitpid(pid, &status, 0);
+    smash.setLastStatus(_exitStatus(status));
+    smash.setForegroundProcess(ERROR_VALUE);
 }
 
-/* Run a complex external command by executing bash */
-void ExternalCommand::runComplexCommand(const string &cmd)
+/* Starts the program without waiting for it, with the given changes to its descriptors */
+pid_t ExternalCommand::launch(const vector<FdAction> &fdActions)
 {
-    // Execute the command using execvp
-    execlp("bash", "bash", "-c", cmd.c_str(), (char *)nullptr);
+    ArgVector expanded;
+    const ArgVector &args = expandArgs(expanded);
+    if (args.isOverflowed())
+    {
+        errno = E2BIG;
+        perror("smash error: execvp failed");
+        return ERROR_VALUE;
+    }
 
-    // If execlp returns, an error occurred
-    perror("smash error: execlp failed");
-    exit(1);
+    // The program's file is looked up in the parent, where the lookups are cached
+    const char *path = SmallShell::getInstance().getPathCache().resolve(args.data()[0]);
+    if (path == nullptr)
+    {
+        perror("smash error: execvp failed");
+        return ERROR_VALUE;
+    }
+    pid_t pid = Launcher::launch(LaunchPlan{path, args.data(), environ, fdActions});
+    if (pid != ERROR_VALUE && Launcher::getExecLatency() >= 0)
+        cerr << "smash launch: " << path << ": " << Launcher::getExecLatency() << " us from fork to exec" << endl;
+    return pid;
 }
 
-vector<string> ExternalCommand::splitCommand(const string &cmd)
+/* The arguments to exec - the command's own, or with every wildcard argument replaced by the paths
+ * it matches, copied into the command arena */
+const ArgVector &ExternalCommand::expandArgs(ArgVector &expanded) const
 {
-    istringstream iss(cmd);
-    vector<string> tokens;
-    for (string token; iss >> token;)
+    char *const *args = getArgs();
+    bool hasWildcards = false;
+    for (char *const *arg = args; *arg != nullptr && !hasWildcards; arg++)
+        hasWildcards = GlobExpander::hasWildcards(*arg);
+    if (!hasWildcards)
+        return m_args;
+
+    Arena &arena = SmallShell::getInstance().getArena();
+    for (char *const *arg = args; *arg != nullptr && !expanded.isOverflowed(); arg++)
     {
-        tokens.push_back(token);
+        if (!GlobExpander::hasWildcards(*arg))
+        {
+            expanded.push(*arg);
+            continue;
+        }
+        for (const string &match : GlobExpander::expand(*arg))
+        {
+            if (!expanded.push(arena.copyString(match.c_str(), match.size())))
+                break;
+        }
     }
-    return tokens;
+    return expanded;
 }
 
 bool ExternalCommand::isExternalCommand() const
@@ -818,7 +2700,7 @@ bool ExternalCommand::isExternalCommand() const
 /*---------------------------------------------------------------------------------------------------*/
 /*---------------------------------------- Special Commands -----------------------------------------*/
 /*---------------------------------------------------------------------------------------------------*/
-ListDirCommand::ListDirCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line) {}
+ListDirCommand::ListDirCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
 
 /* Execute method to get and print theListDirCommand */
 void ListDirCommand::execute()
@@ -830,8 +2712,7 @@ void ListDirCommand::execute()
         return;
     }
 
-    vector<string> args = getArgs();
-    const char *directoryPath = (getArgCount() == 2) ? args[1].c_str() : ".";
+    const char *directoryPath = (getArgCount() == 2) ? getArgs()[1] : ".";
 
     // Open directory - return if failed.
     int fd = open(directoryPath, O_RDONLY | O_DIRECTORY);
@@ -909,47 +2790,40 @@ void ListDirCommand::printContent(vector<string> entries, const char *directoryP
     }
 }
 
-RedirectionCommand::RedirectionCommand(const char *origin_cmd_line, const char *cmd_line) : Command(origin_cmd_line, cmd_line), m_isDouble(false)
-{
-    int index = m_cmd_string.find_first_of('>'), start = 1;
-    const char *command = strdup(m_cmd_string.substr(0, index).c_str());
-    // commans > case (not command>)
-    if (m_cmd_string[index + start] == ' ')
-        start = 2;
-
-    // in case using '>>' instead of '>'
-    else if (m_cmd_string[index + start] == '>')
-    {
-        m_isDouble = true;
-        start = 3;
-    }
-
-    const char *file = strdup(m_cmd_string.substr(index + start, m_cmd_string.size() - index).c_str());
-
-    m_firstCmd = strdup((_trim(string(command)) + " ").c_str());
-    m_secondCmd = strdup((string(file)).c_str());
-
-    // Free malloced memory
-    free(const_cast<char *>(command));
-    free(const_cast<char *>(file));
-}
-
-RedirectionCommand::~RedirectionCommand()
-{
-    // Free malloced memory
-    free(const_cast<char *>(m_firstCmd));
-    free(const_cast<char *>(m_secondCmd));
-}
+RedirectionCommand::RedirectionCommand(const char *origin_cmd_line, const CommandAST &ast) : Command(origin_cmd_line, ast),
+                                                                                            m_firstCmd(ast.withoutRedirection(SmallShell::getInstance().getArena())),
+                                                                                            m_secondCmd(ast.stages[0].redirectTarget),
+                                                                                            m_isDouble(ast.stages[0].isAppend) {}
 
+/* Programs get the file as their output in the one child that execs them - the file is opened here so
+ * a failure is reported before anything runs. Other commands run in a forked copy of the shell */
 void RedirectionCommand::execute()
 {
     // breaking the cmd_line to a command and filename
     SmallShell &smash = SmallShell::getInstance();
+    if (smash.resolveCommand(m_firstCmd) == &_createCommand<ExternalCommand>)
+    {
+        int outputFile = open(m_secondCmd, O_WRONLY | O_CREAT | O_CLOEXEC | (m_isDouble ? O_APPEND : O_TRUNC), 0666);
+        if (outputFile < 0)
+        {
+            perror("smash error: open failed");
+            smash.setLastStatus(1);
+            return;
+        }
+        ExternalCommand program(m_origin_cmd_string, m_firstCmd, false);
+        program.runInForeground({{FdAction::FD_DUP, STDOUT_FILENO, outputFile}});
+        close(outputFile);
+        return;
+    }
 
     // forking the process, the son implement the command and writing the output while the parent wait
     pid_t pid = fork();
     if (pid < 0)
+    {
         perror("smash error: fork failed");
+        smash.setLastStatus(1);
+        return;
+    }
 
     // son processes
     if (pid == 0)
@@ -963,17 +2837,17 @@ void RedirectionCommand::execute()
         if (outputFile < 0)
         {
             perror("smash error: open failed");
-            exit(0);
+            exit(1);
         }
         if (dup2(outputFile, STDOUT_FILENO) < 0)
         {
             perror("smash error: dup2 failed");
             close(outputFile);
-            exit(0);
+            exit(1);
         }
-        smash.executeCommand(m_firstCmd);
+        smash.executeCommand(m_origin_cmd_string, m_firstCmd);
         close(outputFile);
-        exit(1);
+        exit(smash.getLastStatus());
     }
 
     // parent processes
@@ -981,11 +2855,12 @@ void RedirectionCommand::execute()
     {
         int status;
         waitpid(pid, &status, 0);
+        smash.setLastStatus(_exitStatus(status));
     }
 }
 
 /* C'tor for getuser command class */
-GetUserCommand::GetUserCommand(const char *origin_cmd_line, const char *cmd_line) : BuiltInCommand(origin_cmd_line, cmd_line) {}
+GetUserCommand::GetUserCommand(const char *origin_cmd_line, const CommandAST &ast) : BuiltInCommand(origin_cmd_line, ast) {}
 
 void GetUserCommand::execute()
 {
@@ -1065,7 +2940,7 @@ void GetUserCommand::printUserByPid(pid_t pid)
 }
 
 /* C'tor for WatchCommand command class */
-WatchCommand::WatchCommand(const char *origin_cmd_line, const char *cmd_line, bool isBg) : Command(origin_cmd_line, cmd_line, isBg) {}
+WatchCommand::WatchCommand(const char *origin_cmd_line, const CommandAST &ast, bool isBg) : Command(origin_cmd_line, ast, isBg) {}
 
 void WatchCommand::execute()
 {
@@ -1082,7 +2957,7 @@ void WatchCommand::execute()
 
 string WatchCommand::getWatchCommand(int &interval)
 {
-    vector<string> args = getArgs();
+    char *const *args = getArgs();
     int argsNum = getArgCount(), start = 2;
     string command = "";
 
@@ -1112,11 +2987,11 @@ string WatchCommand::getWatchCommand(int &interval)
     return command;
 }
 
-void WatchCommand::extractWatchCommand(string &command, int start, vector<string> args, int argsNum)
+void WatchCommand::extractWatchCommand(string &command, int start, char *const *args, int argsNum)
 {
     // Concatenate all arguments for the command from start
     for (int i = start; i < argsNum; ++i){
-        command += args[i] + " ";
+        command += string(args[i]) + " ";
     }
 
     // Remove the trailing space at the end if it exists
@@ -1171,26 +3046,14 @@ void WatchCommand::watchLoop(string command, int interval){
 }
 
 /* C'tor for pipe command class */
-PipeCommand::PipeCommand(const char *origin_cmd_line, const char *cmd_line) : Command(origin_cmd_line, cmd_line)
-{
-    // Checking if its '|' or '|&| pipe
-    char c = '|';
-    m_isErr = (m_cmd_string[m_cmd_string.find_first_of(c) + 1] == '&');
-    if (m_isErr)
-        c = '&';
-
-    // Split the commands
-    string command1 = (m_isErr ? m_cmd_string.substr(0, m_cmd_string.find_first_of(c) - 1)
-                               : m_cmd_string.substr(0, m_cmd_string.find_first_of(c)));
-    string command2 = m_cmd_string.substr(m_cmd_string.find_first_of(c) + 1);
-    m_firstCmd = _trim(command1);
-    m_secondCmd = _trim(command2) + " ";
-}
+PipeCommand::PipeCommand(const char *origin_cmd_line, const CommandAST &ast) : Command(origin_cmd_line, ast),
+                                                                              m_firstCmd(ast.slice(0, 1, SmallShell::getInstance().getArena())),
+                                                                              m_secondCmd(ast.slice(1, ast.stages.size(), SmallShell::getInstance().getArena())),
+                                                                              m_isErr(ast.stages[0].isPipeErr) {}
 
 void PipeCommand::execute()
 {
     SmallShell &smash = SmallShell::getInstance();
-    string temp;
 
     // Create pipe
     int fd[2];
@@ -1200,69 +3063,60 @@ void PipeCommand::execute()
         return;
     }
 
-    // First child process (command1)
-    pid_t firstPid = fork();
+    // fd[1] is the writing end, it replaces the first command's output channel
+    int outputChannel = (m_isErr ? STDERR_FILENO : STDOUT_FILENO);
+    // A stage that fails to start leaves the other one to see the pipe closed
+    pid_t firstPid = startStage(m_firstCmd, fd[1], outputChannel, fd);
+    pid_t secondPid = startStage(m_secondCmd, fd[0], STDIN_FILENO, fd);
 
-    // Error forking
-    if (firstPid < FORK_SUCCEED)
+    // parent process - the status of a pipeline is the status of its last command
+    int status;
+    close(fd[0]);
+    close(fd[1]);
+    if (firstPid != ERROR_VALUE)
+        waitpid(firstPid, &status, 0);
+    if (secondPid == ERROR_VALUE)
     {
-        perror("smash error: fork failed");
-        close(fd[0]);
-        close(fd[1]);
+        smash.setLastStatus(1);
         return;
     }
+    waitpid(secondPid, &status, 0);
+    smash.setLastStatus(_exitStatus(status));
+}
 
-    // If fork succeed, connect appropriate channel
-    if (firstPid == FORK_SUCCEED)
+/* Starts one side of the pipe with pipeEnd as its channel. Programs are launched straight onto the
+ * pipe, anything else runs in a forked copy of the shell */
+pid_t PipeCommand::startStage(const CommandAST &stage, int pipeEnd, int channel, const int pipeFds[2])
+{
+    SmallShell &smash = SmallShell::getInstance();
+    if (smash.resolveCommand(stage) == &_createCommand<ExternalCommand>)
     {
-        setpgrp();
-        close(fd[0]);
-        int outputChannel = (m_isErr ? STDERR_FILENO : STDOUT_FILENO);
-        if (dup2(fd[1], outputChannel) < 0)
-        { // fd[1] is the writing end
-            perror("smash error: dup2 failed");
-            close(fd[1]);
-            return;
-        }
-        close(fd[1]);
-        smash.executeCommand(m_firstCmd.c_str());
-        exit(0);
+        ExternalCommand program(m_origin_cmd_string, stage, false);
+        return program.launch({{FdAction::FD_DUP, channel, pipeEnd},
+                               {FdAction::FD_CLOSE, pipeFds[0], 0},
+                               {FdAction::FD_CLOSE, pipeFds[1], 0}});
     }
 
-    // Second child process (command2)
-    pid_t secondPid = fork();
-
-    // Error forking
-    if (secondPid < FORK_SUCCEED)
+    pid_t pid = fork();
+    if (pid == ERROR_VALUE)
     {
         perror("smash error: fork failed");
-        close(fd[0]);
-        close(fd[1]);
-        return;
+        return ERROR_VALUE;
     }
+    if (pid != CHILD_ID)
+        return pid;
 
-    // If fork succeed, connect appropriate channel
-    if (secondPid == FORK_SUCCEED)
+    // Child - connect the channel to the pipe and run the stage
+    setpgrp();
+    if (dup2(pipeEnd, channel) < 0)
     {
-        setpgrp();
-        close(fd[1]);
-        if (dup2(fd[0], STDIN_FILENO) < 0)
-        { // fd[1] is the writing end
-            perror("smash error: dup2 failed");
-            close(fd[1]);
-            return;
-        }
-        close(fd[0]);
-        smash.executeCommand((m_secondCmd).c_str());
-        exit(0);
+        perror("smash error: dup2 failed");
+        exit(1);
     }
-
-    // parent process
-    int status;
-    close(fd[0]);
-    close(fd[1]);
-    waitpid(firstPid, &status, 0);
-    waitpid(secondPid, &status, 0);
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+    smash.executeCommand(m_origin_cmd_string, stage);
+    exit(smash.getLastStatus());
 }
 
 /*---------------------------------------------------------------------------------------------------*/
@@ -1270,7 +3124,9 @@ void PipeCommand::execute()
 /*---------------------------------------------------------------------------------------------------*/
 
 /* C'tor for JobEntry & Setters/Getters */
-JobsList::JobEntry::JobEntry(int id, int pid, Command *cmd, bool stopped) : m_jobID(id), m_processID(pid), m_command(cmd) {}
+JobsList::JobEntry::JobEntry(int id, int pid, const Command &cmd, bool stopped) : m_jobID(id), m_processID(pid),
+                                                                                  m_originalCommand(cmd.getOriginalCommand()),
+                                                                                  m_command(cmd.getCommand()) {}
 
 void JobsList::JobEntry::setJobID(int id)
 {
@@ -1282,11 +3138,6 @@ void JobsList::JobEntry::setProcessID(int id)
     m_processID = id;
 }
 
-void JobsList::JobEntry::setCommand(Command *cmd)
-{
-    m_command = cmd;
-}
-
 int JobsList::JobEntry::getJobID() const
 {
     return m_jobID;
@@ -1297,7 +3148,12 @@ int JobsList::JobEntry::getProcessID() const
     return m_processID;
 }
 
-Command *JobsList::JobEntry::getCommand() const
+const string &JobsList::JobEntry::getOriginalCommand() const
+{
+    return m_originalCommand;
+}
+
+const string &JobsList::JobEntry::getCommand() const
 {
     return m_command;
 }
@@ -1324,7 +3180,7 @@ void JobsList::addJob(Command *command, int jobPid, bool isStopped)
 {
     // Remove all finshed background jobs.
     removeFinishedJobs();
-    m_jobEntries->push_back(JobEntry(m_nextJobID++, jobPid, command, isStopped));
+    m_jobEntries->push_back(JobEntry(m_nextJobID++, jobPid, *command, isStopped));
     m_numRunningJobs++;
 }
 
@@ -1372,7 +3228,6 @@ void JobsList::removeJobById(int jobId)
         // Remove given job.
         if (it->getJobID() == jobId)
         {
-            delete (it->getCommand());
             m_jobEntries->erase(it);
             m_numRunningJobs--;
 
@@ -1396,8 +3251,6 @@ void JobsList::removeFinishedJobs()
         // The child process of this job has terminated - Erase it from the list.
         if (result == it->getProcessID())
         {
-            // Free allocated memory of command
-            delete it->getCommand();
             it = m_jobEntries->erase(it);
         }
         else
@@ -1429,7 +3282,7 @@ void JobsList::printJobsList()
     // Print the jobs list in the required format
     for (const auto &job : *m_jobEntries)
     {
-        cout << "[" << job.getJobID() << "] " << job.getCommand()->getOriginalCommand() << endl;
+        cout << "[" << job.getJobID() << "] " << job.getOriginalCommand() << endl;
     }
 }
 
@@ -1446,7 +3299,7 @@ void JobsList::printJobsListWithPid()
     // Print the jobs list in the required format
     for (const auto &job : *m_jobEntries)
     {
-        cout << job.getProcessID() << ": " << job.getCommand()->getOriginalCommand() << endl;
+        cout << job.getProcessID() << ": " << job.getOriginalCommand() << endl;
     }
 }
 
@@ -4,11 +4,19 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <list>
+#include <unordered_map>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <bitset>
+#include <mutex>
+#include <condition_variable>
 
 
-#define COMMAND_MAX_LENGTH (200)
-#define COMMAND_MAX_ARGS (20)
 #define CD_COMMAND_ARGS_NUM (2)
 #define LIST_DIR_COMMAND_ARGS_NUM (2)
 #define DEFAULT_INTERVAL_TIME (2)
@@ -22,21 +30,471 @@
 #define FORK_SUCCEED (0)
 #define ERROR_VALUE (-1)
 #define BIG_NUMBER (1000)
+#define INPUT_BUFFER_SIZE (1 << 16)
+#define ARENA_BLOCK_SIZE (4096)
+#define ARGV_INLINE_SIZE (16)
+#define PLAN_ARENA_BLOCK_SIZE (512)
+#define COMMAND_CACHE_SIZE (256)
+#define GLOB_BUFFER_SIZE (32768)
+#define GLOB_PARALLEL_MIN_DIRS (64)
+#define GLOB_MAX_THREADS (8)
+#define COMPLETION_MAX_DIR_ENTRIES (1 << 16)
+#define BUILTIN_TABLE_BITS (8)
+#define BUILTIN_TABLE_SIZE (1 << BUILTIN_TABLE_BITS)
+#define FNV_OFFSET_BASIS (2166136261u)
+#define FNV_PRIME (16777619u)
+#define RC_FILE_NAME ".smashrc"
+#define RC_SNAPSHOT_SUFFIX ".snapshot"
+#define DEFAULT_PATH "/bin:/usr/bin"   // searched when PATH is unset, as by execvp
 
 using namespace std;
 
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Arena Allocator -----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Bump pointer allocator - memory is released all at once by rewinding to a mark or resetting */
+class Arena {
+public:
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+
+    explicit Arena(size_t blockSize = ARENA_BLOCK_SIZE);
+    ~Arena();
+    Arena(Arena const &) = delete;
+    void operator=(Arena const &) = delete;
+
+    void *allocate(size_t size, size_t alignment = alignof(max_align_t));
+    char *copyString(const char *str, size_t length);
+    Mark getMark() const;
+    void rewind(Mark mark);
+    void reset();
+
+    /* Statistics */
+    size_t getAllocationCount() const;
+    size_t getBlockCount() const;
+
+private:
+    struct Block {
+        char *data;
+        size_t size;
+    };
+
+    vector<Block> m_blocks;
+    size_t m_blockSize;
+    size_t m_current;
+    size_t m_offset;
+    size_t m_allocationCount;   // allocations served from the arena
+};
+
+/* Rewinds the arena to where it was when the scope started */
+class ArenaScope {
+public:
+    explicit ArenaScope(Arena &arena);
+    ~ArenaScope();
+    ArenaScope(ArenaScope const &) = delete;
+    void operator=(ArenaScope const &) = delete;
+
+private:
+    Arena &m_arena;
+    Arena::Mark m_mark;
+};
+
+/* STL allocator drawing from an arena, deallocation is a no-op */
+template <class T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(Arena &arena) : m_arena(&arena) {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : m_arena(other.getArena()) {}
+
+    T *allocate(size_t n) { return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T *, size_t) {}
+    Arena *getArena() const { return m_arena; }
+
+private:
+    Arena *m_arena;
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.getArena() == b.getArena(); }
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.getArena() != b.getArena(); }
+
+template <class T>
+using ArenaVector = vector<T, ArenaAllocator<T>>;
+
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Argument Vector -----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* NULL terminated argv passed as is to exec - short commands fit in the inline storage, longer ones
+ * move to the heap. Arguments past the kernel's ARG_MAX are refused and mark the vector overflowed */
+class ArgVector {
+public:
+    ArgVector();
+    ~ArgVector();
+    ArgVector(ArgVector const &) = delete;
+    void operator=(ArgVector const &) = delete;
+
+    bool push(char *arg);
+    size_t size() const;
+    bool isOverflowed() const;
+    char *const *data() const;
+
+private:
+    char *m_inline[ARGV_INLINE_SIZE];
+    char **m_data;
+    size_t m_size;          // arguments, not counting the NULL terminator
+    size_t m_capacity;
+    size_t m_bytes;         // strings and pointers exec copies into the new process
+    bool m_overflowed;
+};
+
+/*---------------------------------------------------------------------------------------------------*/
+/*--------------------------------------- Command Line Parser ---------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+enum TokenType {
+    TOKEN_WORD,
+    TOKEN_REDIRECT,         // '>'
+    TOKEN_REDIRECT_APPEND,  // '>>'
+    TOKEN_PIPE,             // '|'
+    TOKEN_PIPE_ERR,         // '|&'
+    TOKEN_BACKGROUND        // '&' at the end of the line
+};
+
+struct Token {
+    TokenType type;
+    char *text;             // arena copy of the word, NULL for operators
+};
+
+/* A single simple command of a pipeline - its words and optional output redirection */
+struct CommandStage {
+    ArenaVector<char *> words;
+    bool hasRedirection;
+    bool isAppend;
+    bool isPipeErr;         // stderr of this stage is sent into the pipe ('|&')
+    const char *redirectTarget;
+
+    explicit CommandStage(Arena &arena);
+};
+
+/* Parsed command line, built once per line by SmallShell::parseCommandLine - all of its
+ * strings live in the arena it was parsed into */
+struct CommandAST {
+    ArenaVector<CommandStage> stages;
+    bool isBackground;
+    const char *text;       // alias expanded command line without the background sign
+
+    explicit CommandAST(Arena &arena);
+    Arena &getArena() const;
+    bool isEmpty() const;
+    const char *firstWord() const;
+    CommandAST slice(size_t first, size_t last, Arena &arena) const;
+    CommandAST withoutRedirection(Arena &arena) const;
+    CommandAST copy(Arena &arena) const;
+};
+
+class Command;
+typedef Command *(*CommandFactory)(const char *origin_cmd_line, const CommandAST &ast);
+
+/* A parsed command line together with the factory it dispatches to - owns the memory of its AST */
+struct CommandPlan {
+    Arena arena;
+    CommandAST ast;
+    CommandFactory factory;
+
+    CommandPlan();
+};
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------ Command Cache ------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Bounded LRU cache of command plans keyed by the raw command line. Plans are tagged with the alias
+ * table generation they were parsed under, and are stale once the aliases change */
+class CommandCache {
+public:
+    explicit CommandCache(size_t capacity = COMMAND_CACHE_SIZE);
+
+    shared_ptr<CommandPlan> find(string_view line, unsigned long generation);
+    void insert(string_view line, unsigned long generation, const CommandAST &ast, CommandFactory factory);
+    void clear();
+    void print() const;
+
+private:
+    struct Entry {
+        string line;
+        unsigned long generation;
+        shared_ptr<CommandPlan> plan;
+        unsigned long hits;
+    };
+
+    list<Entry> m_entries;      // most recently used first
+    unordered_map<string_view, list<Entry>::iterator> m_index;
+    size_t m_capacity;
+    unsigned long m_hits;
+    unsigned long m_misses;
+};
+
+/*---------------------------------------------------------------------------------------------------*/
+/*----------------------------------------- Glob Expansion ------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Pattern of a single path component ('*', '?' and '[...]') compiled once into matching steps */
+class GlobPattern {
+public:
+    explicit GlobPattern(string_view pattern);
+
+    bool isLiteral() const;
+    bool matches(string_view name) const;
+
+private:
+    enum StepType {
+        GLOB_CHAR,
+        GLOB_ANY_CHAR,      // '?'
+        GLOB_ANY_STRING,    // '*'
+        GLOB_CLASS          // '[...]'
+    };
+
+    struct Step {
+        StepType type;
+        char c;
+        size_t classIndex;
+    };
+
+    bool matchesStep(const Step &step, char c) const;
+
+    vector<Step> m_steps;
+    vector<bitset<256>> m_classes;
+    bool m_isLiteral;
+};
+
+/* Directory record returned by getdents64 */
+struct linux_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+/* Expands a word with wildcards into the sorted paths it matches, reading directories with getdents64.
+ * A '**' component matches any number of directories, large trees are walked by several threads */
+class GlobExpander {
+public:
+    static bool hasWildcards(const char *word);
+    static vector<string> expand(const char *word);
+
+private:
+    struct DirEntry {
+        string name;
+        bool isDirectory;   // for links - whether they point to a directory
+        bool isLink;
+    };
+
+    /* Shared state of the threads walking a '**' tree */
+    struct TreeWalk {
+        mutex lock;
+        condition_variable changed;
+        vector<string> pending;
+        vector<string> matches;
+        int busyWorkers;
+        bool withFiles;
+    };
+
+    static bool readDirectory(const string &path, vector<DirEntry> &entries);
+    static void visitDirectory(const string &path, bool withFiles, vector<string> &subdirs, vector<string> &matches);
+    static void walkTree(const string &base, bool withFiles, vector<string> &matches);
+    static void walkWorker(TreeWalk &walk);
+};
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------- Alias Table -------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Aliases hashed by name and linked in the order they were defined - lookup, insert and remove are
+ * O(1), and listing walks the links. The generation changes with every definition and removal */
+class AliasTable {
+public:
+    struct BodyToken {
+        TokenType type;
+        string text;        // empty for operators
+    };
+
+    struct Alias {
+        string name;
+        string command;     // the body the name expands to
+        string display;     // "='body'" as written in the definition, printed after the name
+        vector<BodyToken> tokens;   // the body, lexed once when the alias is defined
+
+        /* Memoized recursive expansion of the body, valid while the generation is unchanged */
+        string resolved;
+        vector<BodyToken> resolvedTokens;
+        unsigned long resolvedGeneration;
+        int resolvingDepth;     // position in the chain being expanded, NOT_RESOLVING otherwise
+    };
+
+    AliasTable();
+
+    const Alias *find(string_view name) const;
+    const Alias *resolve(string_view name);
+    bool insert(const string &name, const string &command, const string &display);
+    bool remove(string_view name);
+    void print() const;
+    unsigned long getGeneration() const;
+    const list<Alias> &getAliases() const;     // in definition order
+
+private:
+    static const int NOT_RESOLVING = -1;
+
+    void resolve(Alias &alias, int depth, int &cutDepth);
+
+    list<Alias> m_aliases;      // in definition order
+    unordered_map<string_view, list<Alias>::iterator> m_index;
+    unsigned long m_generation;
+};
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------ Process Launcher ---------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+enum LaunchBackend {
+    LAUNCH_SPAWN,       // posix_spawn - the child shares the shell's memory until it execs
+    LAUNCH_FORK
+};
+
+/* Change to the child's descriptors, applied in order before the exec */
+struct FdAction {
+    enum Kind {
+        FD_DUP,         // dup2(source, fd)
+        FD_CLOSE
+    };
+
+    Kind kind;
+    int fd;
+    int source;
+};
+
+/* Everything the child needs, prepared by the shell before the launch - the child only joins its
+ * process group, applies the fd actions and execs */
+struct LaunchPlan {
+    const char *path;           // the file to exec
+    char *const *argv;
+    char *const *envp;
+    vector<FdAction> fdActions;
+};
+
+/* Program names resolved to their file in PATH. An entry holds while PATH keeps its value and the
+ * directory it was found in keeps its mtime - as with a shell's hash table, a program added to an
+ * earlier PATH directory is only found after 'hash -r'. Names that were not found are remembered too,
+ * until PATH or the mtime of any of its directories changes */
+class PathCache {
+public:
+    PathCache();
+
+    const char *resolve(const char *name);      // the file to exec, nullptr with errno set if there is none
+    void clear();
+    void print() const;
+
+private:
+    struct Entry {
+        string path;            // empty while unresolved
+        string directory;
+        struct timespec directoryMtime;
+        int error;              // errno of the last search if it failed, 0 otherwise
+        unsigned long generation;   // directory generation the failed search ran in
+        unsigned long hits;
+        unsigned long misses;
+    };
+
+    struct Directory {
+        string path;
+        struct timespec mtime;  // zero for a directory that does not exist
+    };
+
+    bool isValid(const Entry &entry) const;
+    bool isKnownMissing(const Entry &entry);
+    bool search(const string &name, Entry &entry) const;
+    void setPathValue(const string &pathValue);
+    void refreshDirectories();
+
+    string m_pathValue;
+    vector<Directory> m_directories;
+    bool m_hasRelativeDirectory;    // misses depend on the working directory, they are not remembered
+    unsigned long m_generation;     // advanced whenever a PATH directory's mtime changes
+    unordered_map<string, Entry> m_entries;
+};
+
+/* Starts external programs in a process group of their own. The spawn backend never copies the
+ * shell's page tables, fork is kept as a fallback */
+class Launcher {
+public:
+    static pid_t launch(const LaunchPlan &plan);    // the child's pid, or -1 after printing the error
+    static void setBackend(LaunchBackend backend);
+    static LaunchBackend getBackend();
+    static void setTiming(bool isTimed);
+    static long getExecLatency();       // microseconds from the fork to the exec of the last timed launch, -1 if untimed
+
+private:
+    static pid_t spawn(const LaunchPlan &plan);
+    static pid_t forkExec(const LaunchPlan &plan);
+};
+
+/*---------------------------------------------------------------------------------------------------*/
+/*-------------------------------------------- Completion -------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Tab completion candidates for the word before the cursor. Command names come from a trie of the
+ * executables on PATH, the builtins and the aliases; file names from cached directory listings. A
+ * directory is read again only when its mtime changes, and only its first COMPLETION_MAX_DIR_ENTRIES
+ * entries are kept, so a huge directory costs one bounded read */
+class Completer {
+public:
+    Completer();
+
+    void complete(const string &line, size_t cursor, const AliasTable &aliases, size_t &wordStart, vector<string> &matches);
+
+private:
+    struct Entry {
+        string name;
+        bool isDirectory;
+        bool isExecutable;
+    };
+
+    struct Listing {
+        struct timespec mtime;
+        bool hasExecutable;     // whether isExecutable was checked, as for PATH directories
+        vector<Entry> entries;
+    };
+
+    struct TrieNode {
+        vector<pair<char, uint32_t>> children;
+        bool isName;
+    };
+
+    const Listing *getListing(const string &path, bool withExecutable, bool &isChanged);
+    static bool readListing(const string &path, bool withExecutable, Listing &listing);
+    void updateCommandTrie();
+    void insertCommand(const string &name);
+    void collectCommands(uint32_t node, string &name, vector<string> &matches) const;
+    void completeCommand(const string &word, const AliasTable &aliases, vector<string> &matches);
+    void completeFile(const string &word, vector<string> &matches);
+
+    unordered_map<string, Listing> m_listings;     // by directory path
+    string m_path;                  // the PATH the trie was built for
+    vector<TrieNode> m_trie;        // node 0 is the root
+};
+
 class Command {
 public:
-    Command(const char *origin_cmd_line, const char *cmd_line, bool isBgCmd = false);
+    Command(const char *origin_cmd_line, const CommandAST &ast, bool isBgCmd = false);
     virtual ~Command();
     virtual void execute() = 0;
 
-    /* Args Methods */
+    /* Args Methods - the arguments and command lines are valid while the line executes */
     int getArgCount() const;
-    vector<string> getArgs() const;
-    string getCommand() const;
-    string getOriginalCommand() const;
-    void setCommand(string cmd);
+    char *const *getArgs() const;
+    const char *getCommand() const;
+    const char *getOriginalCommand() const;
+    void setCommand(string_view cmd);
     bool isBackgroundCommand() const;
     virtual bool isExternalCommand() const;
 
@@ -44,70 +502,76 @@ public:
     //virtual void cleanup();
     // TODO: Add your extra methods if needed
 protected:
-    string m_origin_cmd_string;
-    string m_cmd_string;
-    bool m_bgCmd;    
+    const char *m_origin_cmd_string;   // the line as typed, owned by the caller
+    const char *m_cmd_string;          // expanded line, in the command arena
+    ArgVector m_args;           // NULL terminated, ready to be passed to exec
+    bool m_bgCmd;
 };
 
 class BuiltInCommand : public Command {
 public:
-    BuiltInCommand(const char* origin_cmd_line, const char *cmd_line);
+    BuiltInCommand(const char* origin_cmd_line, const CommandAST &ast);
     virtual ~BuiltInCommand() {}
 
 };
 
 class ExternalCommand : public Command {
 public:
-    ExternalCommand(const char* origin_cmd_line, const char *cmd_line, bool isBgCmd);
+    ExternalCommand(const char* origin_cmd_line, const CommandAST &ast, bool isBgCmd);
 
     virtual ~ExternalCommand() {}
 
     void execute() override;
-    void runSimpleCommand(const string& cmd);
-    void runComplexCommand(const string& cmd);
-    vector<string> splitCommand(const string& cmd);
+    void runInForeground(const vector<FdAction> &fdActions);
+    pid_t launch(const vector<FdAction> &fdActions = vector<FdAction>());
     bool isExternalCommand() const override;
+
+private:
+    const ArgVector &expandArgs(ArgVector &expanded) const;
 };
 
 class PipeCommand : public Command {
 protected:
-    string m_firstCmd;
-    string m_secondCmd;
+    CommandAST m_firstCmd;
+    CommandAST m_secondCmd;
     bool m_isErr;
 
 public:
-    PipeCommand(const char* origin_cmd_line, const char *cmd_line);
+    PipeCommand(const char* origin_cmd_line, const CommandAST &ast);
 
     virtual ~PipeCommand() {}
 
     void execute() override;
+
+private:
+    pid_t startStage(const CommandAST &stage, int pipeEnd, int channel, const int pipeFds[2]);
 };
 
 class WatchCommand : public Command {
 private:
     class InvalidInterval : public exception{};
 public:
-    WatchCommand(const char *origin_cmd_line, const char *cmd_line, bool isBg);
+    WatchCommand(const char *origin_cmd_line, const CommandAST &ast, bool isBg);
     virtual ~WatchCommand() {}
     
     void execute() override;
     string getWatchCommand(int& interval);
-    void extractWatchCommand(string& command, int start, vector<string> args, int argsNum);
+    void extractWatchCommand(string& command, int start, char *const *args, int argsNum);
     bool updateInterval(string value, int& interval);
     void watchLoop(string command, int interval);
 };
 
 class RedirectionCommand : public Command {
 protected:
-    const char* m_firstCmd;
+    CommandAST m_firstCmd;
     const char* m_secondCmd;
     bool m_isDouble;
 
 public:
-    explicit RedirectionCommand(const char *origin_cmd_line, const char *cmd_line);
+    explicit RedirectionCommand(const char *origin_cmd_line, const CommandAST &ast);
 
 
-    virtual ~RedirectionCommand();
+    virtual ~RedirectionCommand() {}
 
     void execute() override;
 
@@ -115,7 +579,7 @@ public:
 
 class ChangeDirCommand : public BuiltInCommand {
 public:
-    ChangeDirCommand(const char* origin_cmd_line, const char *cmd_line, char *plastPwd);
+    ChangeDirCommand(const char* origin_cmd_line, const CommandAST &ast, char *plastPwd);
 
     ~ChangeDirCommand() override;
 
@@ -127,7 +591,7 @@ protected:
 
 class GetCurrDirCommand : public BuiltInCommand {
 public:
-    GetCurrDirCommand(const char* origin_cmd_line, const char *cmd_line);
+    GetCurrDirCommand(const char* origin_cmd_line, const CommandAST &ast);
 
 
     virtual ~GetCurrDirCommand() {}
@@ -137,7 +601,7 @@ public:
 
 class ShowPidCommand : public BuiltInCommand {
 public:
-    ShowPidCommand(const char* origin_cmd_line, const char *cmd_line);
+    ShowPidCommand(const char* origin_cmd_line, const CommandAST &ast);
 
 
     virtual ~ShowPidCommand() {}
@@ -151,7 +615,7 @@ class QuitCommand : public BuiltInCommand {
 protected:
     JobsList* m_jobsList;
 public:
-    QuitCommand(const char* origin_cmd_line, const char *cmd_line, JobsList *jobs);
+    QuitCommand(const char* origin_cmd_line, const CommandAST &ast, JobsList *jobs);
 
     virtual ~QuitCommand() {}
 
@@ -164,17 +628,18 @@ public:
     protected:
         int m_jobID;
         int m_processID;
-        Command* m_command;    
+        string m_originalCommand;   // the job outlives its line, the command lines are copied
+        string m_command;
     public:
-        JobEntry(int id, int pid, Command* cmd, bool stopped);
+        JobEntry(int id, int pid, const Command &cmd, bool stopped);
 
         /* Setters & Getters */
         void setJobID(int id);
         void setProcessID(int id);
-        void setCommand(Command* cmd);
         int getJobID() const;
         int getProcessID() const;
-        Command* getCommand() const;
+        const string &getOriginalCommand() const;
+        const string &getCommand() const;
 
 
     };
@@ -209,7 +674,7 @@ protected:
     JobsList* m_jobsList;
 
 public:
-    JobsCommand(const char* origin_cmd_line, const char *cmd_line, JobsList *jobs);
+    JobsCommand(const char* origin_cmd_line, const CommandAST &ast, JobsList *jobs);
 
     virtual ~JobsCommand() {}
 
@@ -221,7 +686,7 @@ protected:
     JobsList* m_jobsList;
     class InvalidArgument : public exception{};
 public:
-    KillCommand(const char* origin_cmd_line, const char *cmd_line, JobsList *jobs);
+    KillCommand(const char* origin_cmd_line, const CommandAST &ast, JobsList *jobs);
 
     virtual ~KillCommand() {}
 
@@ -233,7 +698,7 @@ protected:
     JobsList* m_jobsList;
     class InvalidArgument : public exception{};
 public:
-    ForegroundCommand(const char* origin_cmd_line, const char *cmd_line, JobsList *jobs);
+    ForegroundCommand(const char* origin_cmd_line, const CommandAST &ast, JobsList *jobs);
 
     virtual ~ForegroundCommand() {}
     void execute() override;
@@ -248,7 +713,7 @@ protected:
         char d_name[];
     };
 public:
-    ListDirCommand(const char* origin_cmd_line, const char *cmd_line);
+    ListDirCommand(const char* origin_cmd_line, const CommandAST &ast);
 
     virtual ~ListDirCommand() {}
 
@@ -259,7 +724,7 @@ public:
 
 class GetUserCommand : public BuiltInCommand {
 public:
-    GetUserCommand(const char *origin_cmd_line, const char *cmd_line);
+    GetUserCommand(const char *origin_cmd_line, const CommandAST &ast);
 
     virtual ~GetUserCommand() {}
 
@@ -271,8 +736,9 @@ class aliasCommand : public BuiltInCommand {
 private:
     string m_name;
     string m_command;
+    bool m_isValid;     // the line is a well formed "alias name='command'"
 public:
-    aliasCommand(const char* origin_cmd_line, const char *cmd_line);
+    aliasCommand(const char* origin_cmd_line, const CommandAST &ast);
     virtual ~aliasCommand() {}
 
     void execute() override;
@@ -280,16 +746,34 @@ public:
 
 class unaliasCommand : public BuiltInCommand {
 public:
-    unaliasCommand(const char* origin_cmd_line, const char *cmd_line);
+    unaliasCommand(const char* origin_cmd_line, const CommandAST &ast);
 
     virtual ~unaliasCommand() {}
 
     void execute() override;
 };
 
+class CacheCommand : public BuiltInCommand {
+public:
+    CacheCommand(const char* origin_cmd_line, const CommandAST &ast);
+
+    virtual ~CacheCommand() {}
+
+    void execute() override;
+};
+
+class HashCommand : public BuiltInCommand {
+public:
+    HashCommand(const char* origin_cmd_line, const CommandAST &ast);
+
+    virtual ~HashCommand() {}
+
+    void execute() override;
+};
+
 class ChangePromptCommand : public BuiltInCommand {
 public:
-    ChangePromptCommand(const char* origin_cmd_line, const char *cmd_line);
+    ChangePromptCommand(const char* origin_cmd_line, const CommandAST &ast);
 
     virtual ~ChangePromptCommand() {}
 
@@ -303,14 +787,17 @@ private:
     pid_t m_fg_process;
     string m_prompt;
     char* m_plastPwd;
-    JobsList* m_jobList;
-    bool* m_proceed;
+    JobsList* m_jobList;        // created on first use
+    bool m_proceed;
     bool m_stopWatch;
-    map<string, string>* m_alias;
-    vector<string> m_aliasToPrint;
+    AliasTable m_aliases;
+    Arena m_arena;              // parse and dispatch memory of the executing command line
+    CommandCache m_commandCache;
+    Completer m_completer;
+    PathCache m_pathCache;
+    int m_lastStatus;           // exit status of the last command, as in '$?'
 
 public:
-    const static set<string> COMMANDS;
     bool toProceed () const;
     void quit ();
 
@@ -320,15 +807,22 @@ public:
     string getPrompt() const;
     bool getStopWatch() const;
     pid_t getForegroundProcess() const;
+    void setLastStatus(int status);
+    int getLastStatus() const;
     void setPlastPwdPtr(char * newPwd);
     char* getPlastPwdPtr();
 
     void addAlias (string name, string command, string originCommand);
-    void removeAlias (vector<string>args);
+    void removeAlias (char *const *args, int argsNum);
     void printAlias();
 
+    void loadRcFile(const string &rcPath);
+    void complete(const string &line, size_t cursor, size_t &wordStart, vector<string> &matches);
+
+    CommandAST parseCommandLine(const char *cmd_line, Arena &arena);
+    CommandFactory resolveCommand(const CommandAST &ast) const;
     Command *CreateCommand(const char *cmd_line);
-    char* extractCommand(const char* cmd_l,string &firstWord);
+    Command *CreateCommand(const char *origin_cmd_line, const CommandAST &ast);
 
     SmallShell(SmallShell const &) = delete; // disable copy ctor
     void operator=(SmallShell const &) = delete; // disable = operator
@@ -342,9 +836,14 @@ public:
     
 
     void executeCommand(const char *cmd_line);
+    void executeCommand(const char *origin_cmd_line, const CommandAST &ast);
+    void executeCommand(const char *origin_cmd_line, const CommandAST &ast, CommandFactory factory);
     void printToTerminal(string line);
 
     JobsList* getJobsList();
+    Arena &getArena();
+    CommandCache &getCommandCache();
+    PathCache &getPathCache();
 };
 
 #endif //SMASH_COMMAND_H_
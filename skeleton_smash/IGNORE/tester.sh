@@ -14,7 +14,7 @@ if [ -d "$FAILED_TESTS_FOLDER" ]
 	fi
 mkdir "$FAILED_TESTS_FOLDER"
 
-g++ -o smash -std=c++11 -DNDEBUG -Wall ../*.cpp
+g++ -o smash -std=c++17 -DNDEBUG -Wall -pthread ../*.cpp
 
 for i in tests/*.in
 do
@@ -0,0 +1,15 @@
+#!/bin/bash
+# Starts the smash running this script twice with its HOME at rchome - the first start runs the rc
+# file and may snapshot it, the second may restore from the snapshot. Both must print the same
+SMASH=$(readlink /proc/$PPID/exe)
+rm -f rchome/.smashrc.snapshot
+HOME=$(pwd)/rchome "$SMASH" empty_file.txt > rc_first.out 2>&1
+HOME=$(pwd)/rchome "$SMASH" empty_file.txt > rc_second.out 2>&1
+cat rc_first.out
+if cmp -s rc_first.out rc_second.out; then
+    echo "second start: same output"
+else
+    echo "second start: different output"
+    cat rc_second.out
+fi
+rm -f rc_first.out rc_second.out rchome/.smashrc.snapshot
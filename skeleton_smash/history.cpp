@@ -0,0 +1,185 @@
+#include "history.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#define TRIGRAM_SIZE (3)
+#define INDEX_STOP_CHECK_INTERVAL (4096)
+
+History::History() : m_fd(-1), m_map(nullptr), m_mapSize(0), m_offsets(1, 0), m_sessionEntries(), m_indexer(),
+                     m_isIndexed(false), m_stopIndexing(false), m_trigrams() {}
+
+History::~History()
+{
+    if (m_indexer.joinable())
+    {
+        m_stopIndexing = true;
+        m_indexer.join();
+    }
+    if (m_map != nullptr)
+        munmap((void *)m_map, m_mapSize);
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*---------------------------------------------- Storage --------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+bool History::open(const std::string &path)
+{
+    m_fd = ::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    struct stat fileStat;
+    if (m_fd < 0 || fstat(m_fd, &fileStat) < 0)
+        return false;
+
+    // Offsets are 32 bits - a history this large is left unread, new entries are still saved
+    if (fileStat.st_size == 0 || (uint64_t)fileStat.st_size >= UINT32_MAX)
+        return fileStat.st_size == 0;
+    void *map = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (map == MAP_FAILED)
+        return false;
+    m_map = (const char *)map;
+    m_mapSize = fileStat.st_size;
+
+    // One scan for the line ends builds the offset index, a last line cut short still counts
+    m_offsets.clear();
+    const char *end = m_map + m_mapSize;
+    for (const char *line = m_map; line < end;)
+    {
+        m_offsets.push_back(line - m_map);
+        const char *newline = (const char *)memchr(line, '\n', end - line);
+        line = (newline != nullptr) ? newline + 1 : end + 1;
+    }
+    m_offsets.push_back(m_mapSize + (m_map[m_mapSize - 1] != '\n'));
+
+    // The mapped entries never change, the index is built beside the shell
+    m_indexer = std::thread(&History::buildIndex, this);
+    return true;
+}
+
+/* Adds the entry unless it repeats the last one. The line is written whole under the file lock */
+void History::append(const std::string &entry)
+{
+    if (entry.empty() || (size() > 0 && this->entry(size() - 1) == entry))
+        return;
+    m_sessionEntries.push_back(entry);
+
+    if (m_fd < 0)
+        return;
+    std::string line = entry + '\n';
+    flock(m_fd, LOCK_EX);
+    ssize_t result;
+    do
+        result = write(m_fd, line.data(), line.size());
+    while (result < 0 && errno == EINTR);
+    flock(m_fd, LOCK_UN);
+}
+
+size_t History::size() const
+{
+    return getMappedCount() + m_sessionEntries.size();
+}
+
+size_t History::getMappedCount() const
+{
+    return m_offsets.size() - 1;
+}
+
+std::string_view History::entry(size_t index) const
+{
+    size_t mappedCount = getMappedCount();
+    if (index >= mappedCount)
+        return m_sessionEntries[index - mappedCount];
+
+    // Each line ends one byte before the next one starts, the last one at the end of the file
+    size_t start = m_offsets[index];
+    return std::string_view(m_map + start, m_offsets[index + 1] - 1 - start);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*---------------------------------------------- Search ---------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+uint32_t _trigramAt(std::string_view text, size_t pos)
+{
+    return ((uint32_t)(unsigned char)text[pos] << 16) | ((uint32_t)(unsigned char)text[pos + 1] << 8) |
+           (unsigned char)text[pos + 2];
+}
+
+/* Runs on the indexer thread, which is the only one to touch the index until it is published */
+void History::buildIndex()
+{
+    for (size_t i = 0; i < getMappedCount(); i++)
+    {
+        if (i % INDEX_STOP_CHECK_INTERVAL == 0 && m_stopIndexing)
+            return;
+        indexEntry(i);
+    }
+    m_isIndexed = true;
+}
+
+bool History::isIndexed() const
+{
+    return m_isIndexed;
+}
+
+/* Entries are indexed in order, so every posting list stays sorted */
+void History::indexEntry(uint32_t index)
+{
+    std::string_view text = entry(index);
+    for (size_t pos = 0; pos + TRIGRAM_SIZE <= text.size(); pos++)
+    {
+        std::vector<uint32_t> &postings = m_trigrams[_trigramAt(text, pos)];
+        if (postings.empty() || postings.back() != index)
+            postings.push_back(index);
+    }
+}
+
+long History::scan(std::string_view query, size_t first, size_t before) const
+{
+    for (size_t i = before; i-- > first;)
+        if (entry(i).find(query) != std::string_view::npos)
+            return i;
+    return -1;
+}
+
+/* This session's entries are the newest, they are scanned first. Queries of a trigram or longer then
+ * walk the rarest of their trigrams' posting lists from the newest entry down, a candidate must be in
+ * every other list and then hold the query itself */
+long History::search(std::string_view query, size_t before) const
+{
+    before = std::min(before, size());
+    size_t mappedCount = getMappedCount();
+    long found = scan(query, mappedCount, before);
+    before = std::min(before, mappedCount);
+    if (found >= 0 || query.size() < TRIGRAM_SIZE || !m_isIndexed)
+        return (found >= 0) ? found : scan(query, 0, before);
+
+    std::vector<const std::vector<uint32_t> *> lists;
+    for (size_t pos = 0; pos + TRIGRAM_SIZE <= query.size(); pos++)
+    {
+        auto it = m_trigrams.find(_trigramAt(query, pos));
+        if (it == m_trigrams.end())
+            return -1;
+        lists.push_back(&it->second);
+    }
+    std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t> *a, const std::vector<uint32_t> *b) {
+        return a->size() < b->size();
+    });
+
+    const std::vector<uint32_t> &rarest = *lists[0];
+    for (auto it = std::lower_bound(rarest.begin(), rarest.end(), before); it != rarest.begin();)
+    {
+        uint32_t candidate = *--it;
+        bool isInAll = std::all_of(lists.begin() + 1, lists.end(), [candidate](const std::vector<uint32_t> *list) {
+            return std::binary_search(list->begin(), list->end(), candidate);
+        });
+        if (isInAll && entry(candidate).find(query) != std::string_view::npos)
+            return candidate;
+    }
+    return -1;
+}
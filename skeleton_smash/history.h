@@ -0,0 +1,52 @@
+#ifndef SMASH__HISTORY_H_
+#define SMASH__HISTORY_H_
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+
+#define HISTORY_FILE_NAME ".smash_history"
+
+/* Command history kept in an append-only file, one entry per line. The file is mapped at startup and
+ * entries are found through an offset index; lines entered since are kept in memory and appended to
+ * the file with a single locked O_APPEND write each, so concurrent shells never interleave entries.
+ * Substring search goes through a trigram index of the mapped entries, built by a background thread
+ * at startup - until it is ready, and for the few entries of this session, the entries are scanned */
+class History {
+public:
+    History();
+    ~History();
+    History(History const &) = delete;
+    void operator=(History const &) = delete;
+
+    bool open(const std::string &path);     // false if the file can't be opened or mapped
+    void append(const std::string &entry);
+
+    size_t size() const;
+    std::string_view entry(size_t index) const;
+    long search(std::string_view query, size_t before) const;   // newest entry below 'before' holding the query, -1 if none
+    bool isIndexed() const;
+
+private:
+    void buildIndex();
+    void indexEntry(uint32_t index);
+    size_t getMappedCount() const;
+    long scan(std::string_view query, size_t first, size_t before) const;
+
+    int m_fd;
+    const char *m_map;
+    size_t m_mapSize;
+    std::vector<uint32_t> m_offsets;        // start of each mapped entry, then one past the end of the last
+    std::vector<std::string> m_sessionEntries;
+
+    std::thread m_indexer;
+    std::atomic<bool> m_isIndexed;
+    std::atomic<bool> m_stopIndexing;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_trigrams;     // trigram -> ascending entry indices
+};
+
+#endif //SMASH__HISTORY_H_
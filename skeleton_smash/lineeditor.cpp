@@ -0,0 +1,510 @@
+#include "lineeditor.h"
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+
+#define DEFAULT_TERMINAL_WIDTH (80)
+#define KEY_READ_SIZE (256)
+#define COMPLETION_MAX_LISTED (200)
+
+enum Key {
+    KEY_CTRL_A = 1,
+    KEY_CTRL_B = 2,
+    KEY_CTRL_C = 3,
+    KEY_CTRL_D = 4,
+    KEY_CTRL_E = 5,
+    KEY_CTRL_F = 6,
+    KEY_CTRL_H = 8,
+    KEY_TAB = 9,
+    KEY_NEWLINE = 10,
+    KEY_CTRL_K = 11,
+    KEY_CTRL_L = 12,
+    KEY_ENTER = 13,
+    KEY_CTRL_N = 14,
+    KEY_CTRL_G = 7,
+    KEY_CTRL_P = 16,
+    KEY_CTRL_R = 18,
+    KEY_CTRL_T = 20,
+    KEY_CTRL_U = 21,
+    KEY_CTRL_W = 23,
+    KEY_CTRL_Y = 25,
+    KEY_ESCAPE = 27,
+    KEY_BACKSPACE = 127
+};
+
+LineEditor::LineEditor(int inFd, int outFd, History &history) : m_inFd(inFd), m_outFd(outFd), m_cookedMode(), m_history(history),
+                                                                m_historyPos(0), m_savedLine(), m_isSearching(false), m_query(),
+                                                                m_match(-1), m_linePrompt(), m_searchedLine(), m_searchedCursor(0),
+                                                                m_prompt(), m_line(), m_cursor(0), m_killed(), m_completion(nullptr),
+                                                                m_isAfterTab(false), m_escape(),
+                                                                m_input(), m_output(), m_result(EDIT_LINE),
+                                                                m_width(DEFAULT_TERMINAL_WIDTH), m_shownPrompt(), m_shown(),
+                                                                m_shownCursor(0) {}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*--------------------------------------------- Terminal --------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Keys are read one by one without echo. ctrl-C arrives as a key rather than a signal, output
+ * processing stays on so '\n' still starts a new line */
+bool LineEditor::enableRawMode()
+{
+    if (tcgetattr(m_inFd, &m_cookedMode) < 0)
+        return false;
+
+    struct termios raw = m_cookedMode;
+    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_cflag |= CS8;
+    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(m_inFd, TCSADRAIN, &raw) < 0)
+        return false;
+
+    struct winsize size;
+    m_width = (ioctl(m_outFd, TIOCGWINSZ, &size) == 0 && size.ws_col > 0) ? size.ws_col : DEFAULT_TERMINAL_WIDTH;
+    return true;
+}
+
+void LineEditor::disableRawMode()
+{
+    tcsetattr(m_inFd, TCSADRAIN, &m_cookedMode);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*--------------------------------------------- Editing ---------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+EditResult LineEditor::readLine(const std::string &prompt, std::string &line)
+{
+    if (!enableRawMode())
+    {
+        perror("smash error: tcsetattr failed");
+        return EDIT_EOF;
+    }
+
+    m_prompt = prompt;
+    m_line.clear();
+    m_cursor = 0;
+    m_escape.clear();
+    m_isSearching = false;
+    m_result = EDIT_LINE;
+    m_historyPos = m_history.size();
+    m_shownPrompt = m_prompt;
+    m_shown.clear();
+    m_shownCursor = 0;
+    m_output = m_prompt;
+    render();
+
+    // Keys are handled a read at a time, a paste is rendered once
+    bool isDone = false;
+    while (!isDone)
+    {
+        if (m_input.empty())
+        {
+            char buffer[KEY_READ_SIZE];
+            ssize_t nread = read(m_inFd, buffer, sizeof(buffer));
+            if (nread < 0 && errno == EINTR)
+                continue;
+            if (nread <= 0)
+            {
+                m_result = EDIT_EOF;
+                break;
+            }
+            m_input.assign(buffer, nread);
+        }
+
+        size_t handled = 0;
+        while (handled < m_input.size() && !isDone)
+            isDone = handleKey(m_input[handled++]);
+        m_input.erase(0, handled);
+        render();
+    }
+
+    // The finished line stays on the screen, the command output starts below it
+    m_output += (m_result == EDIT_INTERRUPTED) ? "^C\n" : "\n";
+    flush();
+    disableRawMode();
+    line = m_line;
+    return m_result;
+}
+
+void LineEditor::setCompletion(CompletionFunction completion)
+{
+    m_completion = completion;
+}
+
+bool LineEditor::handleKey(unsigned char key)
+{
+    bool isRepeatedTab = m_isAfterTab && key == KEY_TAB;
+    m_isAfterTab = (key == KEY_TAB);
+    if (m_isSearching && m_escape.empty() && handleSearchKey(key))
+        return false;
+    if (!m_escape.empty() || key == KEY_ESCAPE)
+    {
+        m_escape += key;
+        handleEscape();
+        return false;
+    }
+
+    switch (key)
+    {
+    case KEY_ENTER:
+    case KEY_NEWLINE:
+        m_cursor = m_line.size();
+        m_result = EDIT_LINE;
+        return true;
+    case KEY_CTRL_C:
+        m_cursor = m_line.size();
+        m_result = EDIT_INTERRUPTED;
+        return true;
+    case KEY_CTRL_D:
+        if (m_line.empty())
+        {
+            m_result = EDIT_EOF;
+            return true;
+        }
+        if (m_cursor < m_line.size())
+            m_line.erase(m_cursor, 1);
+        break;
+    case KEY_CTRL_A:
+        m_cursor = 0;
+        break;
+    case KEY_CTRL_E:
+        m_cursor = m_line.size();
+        break;
+    case KEY_CTRL_B:
+        m_cursor -= (m_cursor > 0);
+        break;
+    case KEY_CTRL_F:
+        m_cursor += (m_cursor < m_line.size());
+        break;
+    case KEY_CTRL_H:
+    case KEY_BACKSPACE:
+        if (m_cursor > 0)
+            m_line.erase(--m_cursor, 1);
+        break;
+    case KEY_CTRL_K:
+        killText(m_cursor, m_line.size());
+        break;
+    case KEY_CTRL_U:
+        killText(0, m_cursor);
+        break;
+    case KEY_CTRL_W:
+        killText(wordStart(m_cursor), m_cursor);
+        break;
+    case KEY_CTRL_Y:
+        m_line.insert(m_cursor, m_killed);
+        m_cursor += m_killed.size();
+        break;
+    case KEY_CTRL_T:
+        if (m_cursor > 0 && m_line.size() >= 2)
+        {
+            m_cursor -= (m_cursor == m_line.size());
+            std::swap(m_line[m_cursor - 1], m_line[m_cursor]);
+            m_cursor++;
+        }
+        break;
+    case KEY_CTRL_P:
+        moveInHistory(-1);
+        break;
+    case KEY_CTRL_N:
+        moveInHistory(1);
+        break;
+    case KEY_CTRL_R:
+        m_isSearching = true;
+        m_query.clear();
+        m_match = -1;
+        m_linePrompt = m_prompt;
+        m_searchedLine = m_line;
+        m_searchedCursor = m_cursor;
+        updateSearch(m_history.size());
+        break;
+    case KEY_CTRL_L:
+        // Clear the screen and draw the line again at the top
+        m_output += "\x1b[H\x1b[2J";
+        m_shownPrompt.clear();
+        m_shown.clear();
+        m_shownCursor = 0;
+        break;
+    case KEY_TAB:
+        completeWord(isRepeatedTab);
+        break;
+    default:
+        if (key >= ' ')
+            m_line.insert(m_cursor++, 1, key);
+        break;
+    }
+    return false;
+}
+
+/* Acts on a complete escape sequence - arrows, home, end, delete and the alt word commands */
+void LineEditor::handleEscape()
+{
+    const std::string &sequence = m_escape;
+    if (sequence.size() < 2)
+        return;
+    char introducer = sequence[1];
+    if ((introducer == '[' && (sequence.size() < 3 || sequence.back() < 0x40 || sequence.back() > 0x7E)) ||
+        (introducer == 'O' && sequence.size() < 3))
+        return;
+
+    if (sequence == "\x1b[A" || sequence == "\x1bOA")
+        moveInHistory(-1);
+    else if (sequence == "\x1b[B" || sequence == "\x1bOB")
+        moveInHistory(1);
+    else if (sequence == "\x1b[C" || sequence == "\x1bOC")
+        m_cursor += (m_cursor < m_line.size());
+    else if (sequence == "\x1b[D" || sequence == "\x1bOD")
+        m_cursor -= (m_cursor > 0);
+    else if (sequence == "\x1b[H" || sequence == "\x1bOH" || sequence == "\x1b[1~" || sequence == "\x1b[7~")
+        m_cursor = 0;
+    else if (sequence == "\x1b[F" || sequence == "\x1bOF" || sequence == "\x1b[4~" || sequence == "\x1b[8~")
+        m_cursor = m_line.size();
+    else if (sequence == "\x1b[3~" && m_cursor < m_line.size())
+        m_line.erase(m_cursor, 1);
+    else if (sequence == "\x1b" "b" || sequence == "\x1b[1;5D")
+        m_cursor = wordStart(m_cursor);
+    else if (sequence == "\x1b" "f" || sequence == "\x1b[1;5C")
+        m_cursor = wordEnd(m_cursor);
+    else if (sequence == "\x1b" "d")
+        killText(m_cursor, wordEnd(m_cursor));
+    else if (sequence == "\x1b\x7f")
+        killText(wordStart(m_cursor), m_cursor);
+    m_escape.clear();
+}
+
+/* Steps through the history, the line being typed is kept to come back to */
+void LineEditor::moveInHistory(int step)
+{
+    if ((step < 0 && m_historyPos == 0) || (step > 0 && m_historyPos == m_history.size()))
+        return;
+    if (m_historyPos == m_history.size())
+        m_savedLine = m_line;
+
+    m_historyPos += step;
+    m_line = (m_historyPos == m_history.size()) ? m_savedLine : std::string(m_history.entry(m_historyPos));
+    m_cursor = m_line.size();
+}
+
+/* Replaces the word with its single match, or extends it to what all matches share. When there is
+ * nothing to add, a second tab lists the matches */
+void LineEditor::completeWord(bool isRepeated)
+{
+    if (m_completion == nullptr)
+        return;
+    size_t wordStart = m_cursor;
+    std::vector<std::string> matches;
+    m_completion(m_line, m_cursor, wordStart, matches);
+    if (matches.empty())
+    {
+        m_output += "\a";
+        return;
+    }
+
+    std::string common = matches[0];
+    for (const std::string &match : matches)
+        common.resize(std::mismatch(common.begin(), common.end(), match.begin(), match.end()).first - common.begin());
+    if (matches.size() == 1 && common.back() != '/')
+        common += ' ';
+
+    size_t wordLength = m_cursor - wordStart;
+    if (common.size() > wordLength)
+    {
+        m_line.replace(wordStart, wordLength, common);
+        m_cursor = wordStart + common.size();
+    }
+    else if (isRepeated)
+        listMatches(matches);
+    else
+        m_output += "\a";
+}
+
+/* Prints the matches in columns below the line, which is then drawn again under them */
+void LineEditor::listMatches(const std::vector<std::string> &matches)
+{
+    moveCursor(m_output, m_prompt.size() + m_shownCursor, m_prompt.size() + m_shown.size());
+    m_output += "\n";
+
+    // Paths are listed by their last component
+    std::vector<std::string> names;
+    size_t columnWidth = 0;
+    for (size_t i = 0; i < matches.size() && i < COMPLETION_MAX_LISTED; i++)
+    {
+        size_t slash = matches[i].find_last_of('/', matches[i].size() - 2);
+        names.push_back((slash == std::string::npos || matches[i].size() < 2) ? matches[i] : matches[i].substr(slash + 1));
+        columnWidth = std::max(columnWidth, names.back().size() + 2);
+    }
+    size_t columns = std::max((size_t)1, m_width / columnWidth);
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        m_output += names[i];
+        bool isRowEnd = (i % columns == columns - 1) || i + 1 == names.size();
+        m_output += isRowEnd ? "\n" : std::string(columnWidth - names[i].size(), ' ');
+    }
+    if (matches.size() > names.size())
+        m_output += "... " + std::to_string(matches.size() - names.size()) + " more\n";
+
+    m_shownPrompt.clear();
+    m_shown.clear();
+    m_shownCursor = 0;
+}
+
+void LineEditor::killText(size_t start, size_t end)
+{
+    if (start >= end)
+        return;
+    m_killed = m_line.substr(start, end - start);
+    m_line.erase(start, end - start);
+    m_cursor = start;
+}
+
+size_t LineEditor::wordStart(size_t pos) const
+{
+    while (pos > 0 && m_line[pos - 1] == ' ')
+        pos--;
+    while (pos > 0 && m_line[pos - 1] != ' ')
+        pos--;
+    return pos;
+}
+
+size_t LineEditor::wordEnd(size_t pos) const
+{
+    while (pos < m_line.size() && m_line[pos] == ' ')
+        pos++;
+    while (pos < m_line.size() && m_line[pos] != ' ')
+        pos++;
+    return pos;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------- Reverse Search ----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Typing extends the query and keeps the match if it still fits, ctrl-R steps to older matches.
+ * Any other key leaves the search with the match as the line */
+bool LineEditor::handleSearchKey(unsigned char key)
+{
+    switch (key)
+    {
+    case KEY_CTRL_R:
+        updateSearch((m_match >= 0) ? m_match : m_history.size());
+        return true;
+    case KEY_CTRL_G:
+        m_line = m_searchedLine;
+        m_cursor = m_searchedCursor;
+        endSearch();
+        return true;
+    case KEY_CTRL_H:
+    case KEY_BACKSPACE:
+        if (!m_query.empty())
+            m_query.pop_back();
+        updateSearch(m_history.size());
+        return true;
+    default:
+        if (key >= ' ' && key != KEY_BACKSPACE)
+        {
+            m_query += key;
+            updateSearch((m_match >= 0) ? m_match + 1 : m_history.size());
+            return true;
+        }
+        endSearch();
+        return false;
+    }
+}
+
+void LineEditor::updateSearch(size_t before)
+{
+    long found = m_query.empty() ? -1 : m_history.search(m_query, before);
+    if (found >= 0)
+    {
+        m_match = found;
+        m_line = std::string(m_history.entry(found));
+        m_cursor = m_line.find(m_query);
+    }
+    bool isFailed = found < 0 && !m_query.empty();
+    setPrompt(std::string(isFailed ? "(failed reverse-i-search)`" : "(reverse-i-search)`") + m_query + "': ");
+}
+
+void LineEditor::endSearch()
+{
+    m_isSearching = false;
+    m_historyPos = m_history.size();
+    setPrompt(m_linePrompt);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*--------------------------------------------- Rendering -------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+void LineEditor::setPrompt(const std::string &prompt)
+{
+    m_prompt = prompt;
+}
+
+/* Brings the screen from what it shows to the current line - only the text after the first changed
+ * character is written, followed by the cursor moves. Screen positions count from the start of the
+ * prompt and wrap at the terminal width */
+void LineEditor::render()
+{
+    // A new prompt is drawn over the old one, with the whole line after it
+    if (m_prompt != m_shownPrompt)
+    {
+        moveCursor(m_output, m_shownPrompt.size() + m_shownCursor, 0);
+        m_output += "\x1b[J" + m_prompt;
+        m_shownPrompt = m_prompt;
+        m_shown.clear();
+        m_shownCursor = 0;
+    }
+
+    size_t base = m_prompt.size(), common = 0;
+    while (common < m_shown.size() && common < m_line.size() && m_shown[common] == m_line[common])
+        common++;
+
+    size_t position = base + m_shownCursor;
+    if (common < m_shown.size() || common < m_line.size())
+    {
+        moveCursor(m_output, position, base + common);
+        m_output.append(m_line, common, std::string::npos);
+        position = base + m_line.size();
+
+        // A line ending on the last column leaves the cursor there, move it to the next row
+        if (common < m_line.size() && position % m_width == 0)
+            m_output += "\n";
+        if (m_line.size() < m_shown.size())
+            m_output += "\x1b[J";
+    }
+    moveCursor(m_output, position, base + m_cursor);
+
+    m_shown = m_line;
+    m_shownCursor = m_cursor;
+    flush();
+}
+
+void LineEditor::moveCursor(std::string &out, size_t from, size_t to) const
+{
+    size_t fromRow = from / m_width, toRow = to / m_width;
+    size_t fromColumn = from % m_width, toColumn = to % m_width;
+    if (toRow < fromRow)
+        out += "\x1b[" + std::to_string(fromRow - toRow) + "A";
+    else if (toRow > fromRow)
+        out += "\x1b[" + std::to_string(toRow - fromRow) + "B";
+
+    if (toColumn == 0 && fromColumn != 0)
+        out += "\r";
+    else if (toColumn > fromColumn)
+        out += "\x1b[" + std::to_string(toColumn - fromColumn) + "C";
+    else if (toColumn < fromColumn)
+        out += "\x1b[" + std::to_string(fromColumn - toColumn) + "D";
+}
+
+void LineEditor::flush()
+{
+    for (size_t written = 0; written < m_output.size();)
+    {
+        ssize_t result = write(m_outFd, m_output.data() + written, m_output.size() - written);
+        if (result < 0 && errno != EINTR)
+            break;
+        written += (result > 0) ? result : 0;
+    }
+    m_output.clear();
+}
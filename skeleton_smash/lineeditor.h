@@ -0,0 +1,85 @@
+#ifndef SMASH__LINEEDITOR_H_
+#define SMASH__LINEEDITOR_H_
+
+#include <string>
+#include <vector>
+#include <termios.h>
+#include "history.h"
+
+enum EditResult {
+    EDIT_LINE,          // a line was entered
+    EDIT_INTERRUPTED,   // ctrl-C, the line was discarded
+    EDIT_EOF            // ctrl-D on an empty line, or the terminal is gone
+};
+
+/* Fills 'matches' with the completions of the word before the cursor, which starts at 'wordStart' */
+typedef void (*CompletionFunction)(const std::string &line, size_t cursor, size_t &wordStart,
+                                   std::vector<std::string> &matches);
+
+/* Interactive line editor over a terminal in raw mode, with emacs key bindings, history navigation,
+ * reverse incremental search (ctrl-R) and tab completion. The terminal is raw only while a line is
+ * edited, commands run in cooked mode. Each keystroke is answered by one write() holding only the
+ * changes since the last screen state */
+class LineEditor {
+public:
+    LineEditor(int inFd, int outFd, History &history);
+
+    EditResult readLine(const std::string &prompt, std::string &line);
+    void setCompletion(CompletionFunction completion);
+
+private:
+    bool enableRawMode();
+    void disableRawMode();
+
+    bool handleKey(unsigned char key);      // true once the line is done
+    void handleEscape();
+    bool handleSearchKey(unsigned char key);    // false if the key ends the search and is handled as usual
+    void updateSearch(size_t before);
+    void endSearch();
+    void moveInHistory(int step);
+    void completeWord(bool isRepeated);
+    void listMatches(const std::vector<std::string> &matches);
+    void killText(size_t start, size_t end);
+    size_t wordStart(size_t pos) const;
+    size_t wordEnd(size_t pos) const;
+
+    void setPrompt(const std::string &prompt);     // drawn by the next render
+    void render();
+    void moveCursor(std::string &out, size_t from, size_t to) const;
+    void flush();
+
+    int m_inFd;
+    int m_outFd;
+    struct termios m_cookedMode;
+
+    History &m_history;
+    size_t m_historyPos;            // entry being edited, m_history.size() for the new line
+    std::string m_savedLine;        // the new line while browsing the history
+
+    /* Reverse search state - the line and prompt from before the search are restored by ctrl-G */
+    bool m_isSearching;
+    std::string m_query;
+    long m_match;                   // history entry shown, -1 before the first match
+    std::string m_linePrompt;
+    std::string m_searchedLine;
+    size_t m_searchedCursor;
+
+    std::string m_prompt;
+    std::string m_line;
+    size_t m_cursor;
+    std::string m_killed;           // last killed text, for ctrl-Y
+    CompletionFunction m_completion;
+    bool m_isAfterTab;              // a second tab in a row lists the matches
+    std::string m_escape;           // escape sequence read so far
+    std::string m_input;            // keys read past the end of the last line, as in a paste
+    std::string m_output;           // screen updates for the next write()
+    EditResult m_result;
+    size_t m_width;                 // terminal columns
+
+    /* What the terminal shows - the prompt, the line after it and the cursor position in the line */
+    std::string m_shownPrompt;
+    std::string m_shown;
+    size_t m_shownCursor;
+};
+
+#endif //SMASH__LINEEDITOR_H_
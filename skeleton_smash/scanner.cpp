@@ -0,0 +1,197 @@
+#include "scanner.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCANNER_X86 1
+#else
+#define SCANNER_X86 0
+#endif
+
+enum ScanKind {
+    SCAN_BOUNDARY,          // whitespace or an operator character
+    SCAN_WHITESPACE,
+    SCAN_NOT_WHITESPACE,
+    SCAN_KINDS_NUM
+};
+
+typedef size_t (*ScanFunction)(const char *line, size_t pos, size_t length);
+
+/*---------------------------------------------------------------------------------------------------*/
+/*---------------------------------------------- Scalar ---------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+constexpr unsigned char CHAR_WHITESPACE = 1;    // " \n\r\t\f\v"
+constexpr unsigned char CHAR_OPERATOR = 2;      // '>', '|', '&'
+
+struct CharClasses {
+    unsigned char table[256];
+};
+
+constexpr CharClasses _makeCharClasses()
+{
+    CharClasses classes = {};
+    for (const char *c = " \n\r\t\f\v"; *c != '\0'; c++)
+        classes.table[(unsigned char)*c] = CHAR_WHITESPACE;
+    for (const char *c = ">&|"; *c != '\0'; c++)
+        classes.table[(unsigned char)*c] = CHAR_OPERATOR;
+    return classes;
+}
+
+constexpr CharClasses CHAR_CLASSES = _makeCharClasses();
+
+template <ScanKind Kind>
+bool _isMatch(char c)
+{
+    unsigned char charClass = CHAR_CLASSES.table[(unsigned char)c];
+    if (Kind == SCAN_BOUNDARY)
+        return charClass != 0;
+    if (Kind == SCAN_WHITESPACE)
+        return charClass == CHAR_WHITESPACE;
+    return charClass != CHAR_WHITESPACE;
+}
+
+template <ScanKind Kind>
+size_t _scanScalar(const char *line, size_t pos, size_t length)
+{
+    while (pos < length && !_isMatch<Kind>(line[pos]))
+        pos++;
+    return pos;
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------- SSE2 & AVX2 -------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+#if SCANNER_X86
+/* Whitespace is ' ' or a byte in '\t'..'\r', found with an unsigned 'byte - 9 <= 4' test. The tail
+ * shorter than a vector is left to the scalar scan */
+template <ScanKind Kind>
+__attribute__((target("sse2"))) size_t _scanSse2(const char *line, size_t pos, size_t length)
+{
+    const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t'), controlRange = _mm_set1_epi8('\r' - '\t');
+    const __m128i greater = _mm_set1_epi8('>'), bar = _mm_set1_epi8('|'), ampersand = _mm_set1_epi8('&');
+
+    for (; pos + 16 <= length; pos += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(line + pos));
+        __m128i control = _mm_sub_epi8(bytes, tab);
+        __m128i found = _mm_or_si128(_mm_cmpeq_epi8(bytes, space),
+                                     _mm_cmpeq_epi8(_mm_min_epu8(control, controlRange), control));
+        if (Kind == SCAN_BOUNDARY)
+        {
+            __m128i operators = _mm_or_si128(_mm_cmpeq_epi8(bytes, greater),
+                                             _mm_or_si128(_mm_cmpeq_epi8(bytes, bar), _mm_cmpeq_epi8(bytes, ampersand)));
+            found = _mm_or_si128(found, operators);
+        }
+
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(found);
+        if (Kind == SCAN_NOT_WHITESPACE)
+            mask ^= 0xFFFFu;
+        if (mask != 0)
+            return pos + __builtin_ctz(mask);
+    }
+    return _scanScalar<Kind>(line, pos, length);
+}
+
+template <ScanKind Kind>
+__attribute__((target("avx2"))) size_t _scanAvx2(const char *line, size_t pos, size_t length)
+{
+    const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t'), controlRange = _mm256_set1_epi8('\r' - '\t');
+    const __m256i greater = _mm256_set1_epi8('>'), bar = _mm256_set1_epi8('|'), ampersand = _mm256_set1_epi8('&');
+
+    for (; pos + 32 <= length; pos += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(line + pos));
+        __m256i control = _mm256_sub_epi8(bytes, tab);
+        __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, space),
+                                        _mm256_cmpeq_epi8(_mm256_min_epu8(control, controlRange), control));
+        if (Kind == SCAN_BOUNDARY)
+        {
+            __m256i operators = _mm256_or_si256(_mm256_cmpeq_epi8(bytes, greater),
+                                                _mm256_or_si256(_mm256_cmpeq_epi8(bytes, bar), _mm256_cmpeq_epi8(bytes, ampersand)));
+            found = _mm256_or_si256(found, operators);
+        }
+
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(found);
+        if (Kind == SCAN_NOT_WHITESPACE)
+            mask = ~mask;
+        if (mask != 0)
+            return pos + __builtin_ctz(mask);
+    }
+    return _scanSse2<Kind>(line, pos, length);
+}
+#endif
+
+/*---------------------------------------------------------------------------------------------------*/
+/*--------------------------------------------- Dispatch --------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+constexpr ScanFunction SCANNERS[][SCAN_KINDS_NUM] = {
+    {_scanScalar<SCAN_BOUNDARY>, _scanScalar<SCAN_WHITESPACE>, _scanScalar<SCAN_NOT_WHITESPACE>},
+#if SCANNER_X86
+    {_scanSse2<SCAN_BOUNDARY>, _scanSse2<SCAN_WHITESPACE>, _scanSse2<SCAN_NOT_WHITESPACE>},
+    {_scanAvx2<SCAN_BOUNDARY>, _scanAvx2<SCAN_WHITESPACE>, _scanAvx2<SCAN_NOT_WHITESPACE>},
+#endif
+};
+
+bool _isSupported(ScannerLevel level)
+{
+#if SCANNER_X86
+    __builtin_cpu_init();
+    if (level == SCANNER_AVX2)
+        return __builtin_cpu_supports("avx2");
+    if (level == SCANNER_SSE2)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return level == SCANNER_SCALAR;
+}
+
+/* SSE2 is the default even where AVX2 is supported - tokens are a few dozen bytes long, so the wider
+ * loads mostly scan past the boundary and bench_scanner measures AVX2 below SSE2. AVX2 stays
+ * selectable through setScannerLevel */
+ScannerLevel _detectScannerLevel()
+{
+    return _isSupported(SCANNER_SSE2) ? SCANNER_SSE2 : SCANNER_SCALAR;
+}
+
+static ScannerLevel scannerLevel = _detectScannerLevel();
+static const ScanFunction *activeScanner = SCANNERS[scannerLevel];
+
+size_t scanBoundary(const char *line, size_t pos, size_t length)
+{
+    return activeScanner[SCAN_BOUNDARY](line, pos, length);
+}
+
+size_t scanWhitespace(const char *line, size_t pos, size_t length)
+{
+    return activeScanner[SCAN_WHITESPACE](line, pos, length);
+}
+
+size_t skipWhitespace(const char *line, size_t pos, size_t length)
+{
+    return activeScanner[SCAN_NOT_WHITESPACE](line, pos, length);
+}
+
+ScannerLevel getScannerLevel()
+{
+    return scannerLevel;
+}
+
+bool setScannerLevel(ScannerLevel level)
+{
+    if (!_isSupported(level))
+        return false;
+    scannerLevel = level;
+    activeScanner = SCANNERS[level];
+    return true;
+}
+
+const char *getScannerName(ScannerLevel level)
+{
+    switch (level)
+    {
+    case SCANNER_AVX2:
+        return "avx2";
+    case SCANNER_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
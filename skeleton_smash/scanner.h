@@ -0,0 +1,23 @@
+#ifndef SMASH__SCANNER_H_
+#define SMASH__SCANNER_H_
+
+#include <cstddef>
+
+/* Byte scanner behind the command line tokenizer. Every scan returns the position of the first byte
+ * at or after 'pos' of its class, or 'length' when there is none. The lines are classified 16 bytes
+ * at a time with SSE2 where the CPU has it, an AVX2 level of 32 bytes can be selected instead */
+enum ScannerLevel {
+    SCANNER_SCALAR,
+    SCANNER_SSE2,
+    SCANNER_AVX2
+};
+
+size_t scanBoundary(const char *line, size_t pos, size_t length);    // whitespace, '>', '|' or '&'
+size_t scanWhitespace(const char *line, size_t pos, size_t length);
+size_t skipWhitespace(const char *line, size_t pos, size_t length);
+
+ScannerLevel getScannerLevel();
+bool setScannerLevel(ScannerLevel level);    // false if the CPU does not support the level
+const char *getScannerName(ScannerLevel level);
+
+#endif //SMASH__SCANNER_H_
@@ -1,23 +1,276 @@
 #include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
 #include <unistd.h>
+#include <fcntl.h>
 #include <sys/wait.h>
 #include <signal.h>
 #include "Commands.h"
 #include "signals.h"
+#include "lineeditor.h"
+#include "history.h"
 #include <csignal>
 #include <cstring>
+#include <cerrno>
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------- Input Engine ------------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Reads command lines from a file descriptor with large read() calls. Lines are handed out in place -
+ * the newline is replaced by '\0' - and stay valid until the next line is read. When the buffer runs
+ * out the unread part moves back to its front, and it grows for lines longer than the buffer */
+class LineReader {
+public:
+    explicit LineReader(int fd);
+    explicit LineReader(const char *text);
+
+    const char *readLine();
+
+private:
+    void fill();
+
+    int m_fd;
+    std::vector<char> m_buffer;
+    size_t m_start;     // first unread byte
+    size_t m_end;       // end of the bytes read so far
+    bool m_eof;
+};
+
+LineReader::LineReader(int fd) : m_fd(fd), m_buffer(INPUT_BUFFER_SIZE), m_start(0), m_end(0), m_eof(false) {}
+
+/* Reader over a command string, as given to 'smash -c' */
+LineReader::LineReader(const char *text) : m_fd(ERROR_VALUE), m_buffer(text, text + strlen(text) + 1), m_start(0),
+                                           m_end(m_buffer.size() - 1), m_eof(true) {}
+
+/* Returns the next line without its newline, nullptr at the end of the input */
+const char *LineReader::readLine()
+{
+    while (true)
+    {
+        char *data = m_buffer.data();
+        char *newline = (char *)memchr(data + m_start, '\n', m_end - m_start);
+        if (newline != nullptr)
+        {
+            *newline = '\0';
+            const char *line = data + m_start;
+            m_start = newline - data + 1;
+            return line;
+        }
+
+        // The last line may end without a newline, there is always room for its terminator
+        if (m_eof)
+        {
+            if (m_start == m_end)
+                return nullptr;
+            data[m_end] = '\0';
+            const char *line = data + m_start;
+            m_start = m_end;
+            return line;
+        }
+        fill();
+    }
+}
+
+void LineReader::fill()
+{
+    // Keep the partial line and make room after it
+    if (m_start > 0)
+    {
+        memmove(m_buffer.data(), m_buffer.data() + m_start, m_end - m_start);
+        m_end -= m_start;
+        m_start = 0;
+    }
+    if (m_end + 1 >= m_buffer.size())
+        m_buffer.resize(2 * m_buffer.size());
+
+    // A signal (ctrl-C) may interrupt the read, it is simply retried
+    ssize_t nread;
+    do
+        nread = read(m_fd, m_buffer.data() + m_end, m_buffer.size() - m_end - 1);
+    while (nread < 0 && errno == EINTR);
+
+    if (nread < 0)
+        perror("smash error: read failed");
+    if (nread <= 0)
+        m_eof = true;
+    else
+        m_end += nread;
+}
+
+/* Writes the prompt with a single write() after anything still buffered by the shell */
+void _writePrompt(std::string &prompt)
+{
+    prompt = SmallShell::getInstance().getPrompt();
+    prompt += "> ";
+    std::cout.flush();
+
+    for (size_t written = 0; written < prompt.size();)
+    {
+        ssize_t result = write(STDOUT_FILENO, prompt.data() + written, prompt.size() - written);
+        if (result < 0 && errno != EINTR)
+            return;
+        written += (result > 0) ? result : 0;
+    }
+}
+
+/* Tab completion for the line editor, from the shell's commands, aliases and files */
+void _completeCommandLine(const std::string &line, size_t cursor, size_t &wordStart, std::vector<std::string> &matches)
+{
+    SmallShell::getInstance().complete(line, cursor, wordStart, matches);
+}
+
+/*---------------------------------------------------------------------------------------------------*/
+/*------------------------------------------ Startup Profile ----------------------------------------*/
+/*---------------------------------------------------------------------------------------------------*/
+/* Time from main to the first prompt, split into phases. Enabled by '--startup-profile', the
+ * breakdown is printed to stderr once the shell is ready for its first command */
+class StartupProfile {
+public:
+    StartupProfile() : m_isEnabled(false), m_start(std::chrono::steady_clock::now()), m_last(m_start), m_phases() {}
+
+    void enable()
+    {
+        m_isEnabled = true;
+    }
+
+    /* Ends the current phase under the given name */
+    void mark(const char *phase)
+    {
+        if (!m_isEnabled)
+            return;
+        auto now = std::chrono::steady_clock::now();
+        m_phases.push_back({phase, now - m_last});
+        m_last = now;
+    }
+
+    void print()
+    {
+        if (!m_isEnabled)
+            return;
+        std::cerr << "smash startup profile:" << std::endl;
+        for (const Phase &phase : m_phases)
+            _printPhase(phase.name, phase.duration);
+        _printPhase("total", m_last - m_start);
+        m_isEnabled = false;
+    }
+
+private:
+    struct Phase {
+        const char *name;
+        std::chrono::steady_clock::duration duration;
+    };
+
+    static void _printPhase(const char *name, std::chrono::steady_clock::duration duration)
+    {
+        auto micros = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(duration);
+        std::cerr << "  " << std::left << std::setw(12) << name << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << micros.count() << " us" << std::endl;
+    }
+
+    bool m_isEnabled;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::steady_clock::time_point m_last;
+    std::vector<Phase> m_phases;
+};
 
 int main(int argc, char *argv[]) {
+    StartupProfile profile;
+    // Options come before the input source - '--startup-profile', '--launcher=spawn|fork' and
+    // '--launch-stats', which prints the fork to exec time of every program
+    int arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (strcmp(argv[arg], "--startup-profile") == 0)
+            profile.enable();
+        else if (strcmp(argv[arg], "--launch-stats") == 0)
+            Launcher::setTiming(true);
+        else if (strcmp(argv[arg], "--launcher=spawn") == 0)
+            Launcher::setBackend(LAUNCH_SPAWN);
+        else if (strcmp(argv[arg], "--launcher=fork") == 0)
+            Launcher::setBackend(LAUNCH_FORK);
+        else {
+            std::cerr << "smash error: " << argv[arg] << ": unknown option" << std::endl;
+            return 2;
+        }
+    }
+
     // Ctrl+C signal
-    if (signal(SIGINT, ctrlCHandler) == SIG_ERR) 
+    if (signal(SIGINT, ctrlCHandler) == SIG_ERR)
         perror("smash error: failed to set ctrl-C handler");
+    profile.mark("signals");
+
+    // All the shell's output goes through cout and cerr, so they need not stay in sync with stdio
+    std::ios::sync_with_stdio(false);
 
     SmallShell &smash = SmallShell::getInstance();
+    profile.mark("shell");
+
+    // Input source - 'smash -c <command>', 'smash <script>' or the standard input. The batch modes
+    // run without a prompt
+    int fd = STDIN_FILENO;
+    bool showPrompt = true;
+    if (arg < argc && strcmp(argv[arg], "-c") == 0) {
+        if (arg + 1 >= argc) {
+            std::cerr << "smash error: -c: option requires an argument" << std::endl;
+            return 2;
+        }
+        showPrompt = false;
+    }
+    else if (arg < argc) {
+        fd = open(argv[arg], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::cerr << "smash error: " << argv[arg] << ": " << strerror(errno) << std::endl;
+            return 127;
+        }
+        showPrompt = false;
+    }
+    LineReader input = (arg + 1 < argc && strcmp(argv[arg], "-c") == 0) ? LineReader(argv[arg + 1]) : LineReader(fd);
+    profile.mark("input");
+
+    // Startup state from ~/.smashrc
+    const char *home = getenv("HOME");
+    if (home != nullptr)
+        smash.loadRcFile(string(home) + "/" + RC_FILE_NAME);
+    profile.mark("rc file");
+
+    // A terminal on both ends gets the line editor, which writes the prompt itself
+    bool isInteractive = showPrompt && isatty(STDIN_FILENO) && isatty(STDOUT_FILENO);
+    History history;
+    if (isInteractive && home != nullptr && !history.open(string(home) + "/" + HISTORY_FILE_NAME))
+        perror("smash error: failed to open history");
+    LineEditor editor(STDIN_FILENO, STDOUT_FILENO, history);
+    editor.setCompletion(_completeCommandLine);
+    profile.mark("history");
+
+    // Run until quit or the end of the input, exiting with the status of the last command
+    std::string prompt, line;
     while (smash.toProceed()) {
-        std::cout << smash.getPrompt() << "> ";
-        std::string cmd_line;
-        std::getline(std::cin, cmd_line);
-        smash.executeCommand(cmd_line.c_str());
+        const char *cmd_line;
+        if (isInteractive) {
+            profile.mark("prompt");
+            profile.print();
+            std::cout.flush();
+            EditResult result = editor.readLine(smash.getPrompt() + "> ", line);
+            if (result == EDIT_EOF)
+                break;
+            if (result == EDIT_INTERRUPTED) {
+                ctrlCHandler(SIGINT);
+                continue;
+            }
+            history.append(line);
+            cmd_line = line.c_str();
+        }
+        else {
+            if (showPrompt)
+                _writePrompt(prompt);
+            profile.mark("prompt");
+            profile.print();
+            cmd_line = input.readLine();
+            if (cmd_line == nullptr)
+                break;
+        }
+        smash.executeCommand(cmd_line);
     }
-    return 0;
-}
\ No newline at end of file
+    std::cout.flush();
+    return smash.getLastStatus();
+}